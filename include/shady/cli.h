@@ -12,6 +12,15 @@ enum ShadyErrorCodes {
     MissingDumpIrArg,
     IncorrectLogLevel = 16,
     InvalidTarget,
+    MissingManifestArg,
+    InvalidManifest,
+    MissingOutputDirArg,
+    InvalidJobCount,
+    MissingStatsArg,
+    MissingTraceArg,
+    CompilationFailed,
+    CannotOpenOutput,
+    BatchJobsFailed,
 };
 
 typedef enum {
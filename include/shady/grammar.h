@@ -566,6 +566,10 @@ struct Node_ {
     IrArena* arena;
     const Type* type;
     NodeTag tag;
+    /// assigned in creation order when the node is interned, unique within the arena
+    NodeId id;
+    /// structural hash, computed once when the node is interned
+    uint64_t hash;
     union NodesUnion {
 #define NODE_PAYLOAD_1(StructName, short_name) StructName short_name;
 #define NODE_PAYLOAD_0(StructName, short_name)
@@ -577,6 +581,8 @@ struct Node_ {
 
 extern const char* node_tags[];
 extern const bool node_type_has_payload[];
+/// sizeof the payload struct of each tag, nodes are only allocated that much room past the header
+extern const size_t node_payload_size[];
 
 //////////////////////////////// Node categories ////////////////////////////////
 
@@ -10,6 +10,8 @@ typedef struct IrArena_ IrArena;
 typedef struct Node_ Node;
 typedef struct Node_ Type;
 typedef unsigned int VarId;
+/// Dense index of a node within its arena, see id_table.h for attaching information to nodes by it
+typedef uint32_t NodeId;
 typedef const char* String;
 
 //////////////////////////////// Lists & Strings ////////////////////////////////
@@ -36,6 +38,14 @@ const Node* first(Nodes nodes);
 Nodes append_nodes(IrArena*, Nodes, const Node*);
 Nodes concat_nodes(IrArena*, Nodes, Nodes);
 
+/// Grows a list one element at a time and only interns it once, use it over append_nodes in loops
+typedef struct NodesBuilder_ NodesBuilder;
+NodesBuilder* begin_nodes(IrArena*);
+void append_to_nodes(NodesBuilder*, const Node*);
+void concat_to_nodes(NodesBuilder*, Nodes);
+Nodes finish_nodes(NodesBuilder*);
+void cancel_nodes(NodesBuilder*);
+
 String string_sized(IrArena* arena, size_t size, const char* start);
 String string(IrArena* arena, const char* start);
 String format_string(IrArena* arena, const char* str, ...);
@@ -51,6 +61,8 @@ Module* new_module(IrArena*, String name);
 IrArena* get_module_arena(const Module*);
 String get_module_name(const Module*);
 Nodes get_module_declarations(const Module*);
+/// Returns NULL if there is no declaration with that name in the module
+Node* get_declaration(const Module*, String name);
 
 //////////////////////////////// Grammar ////////////////////////////////
 
@@ -86,6 +98,10 @@ ArenaConfig default_arena_config();
 
 IrArena* new_ir_arena(ArenaConfig);
 void destroy_ir_arena(IrArena*);
+/// Turns an arena that is no longer needed into an empty one with the given config, keeping its memory around.
+/// `retired` may be NULL, in which case a fresh arena is created. If `size_hint` is given, the interning sets
+/// are grown up-front to hold as many entries as it has, to avoid rehashing while they fill up again.
+IrArena* reuse_ir_arena(IrArena* retired, ArenaConfig, const IrArena* size_hint);
 
 //////////////////////////////// Getters ////////////////////////////////
 
@@ -103,13 +119,36 @@ static inline bool is_physical_as(AddressSpace as) { return as <= PhysicalAddres
 /// (amongst threads in the same subgroup)
 bool is_addr_space_uniform(IrArena*, AddressSpace);
 
+/// Annotations the compiler looks for itself: their names are interned up-front so they can be found without comparing strings
+#define KNOWN_ANNOTATIONS(X) \
+X(EntryPoint)                \
+X(EntryPointArgs)            \
+X(WorkgroupSize)             \
+X(DescriptorSet)             \
+X(DescriptorBinding)         \
+X(Builtin)                   \
+X(Generated)                 \
+X(Leaf)                      \
+X(MaybeLeaf)                 \
+X(DisablePass)               \
+
+typedef enum {
+#define X(name) KnownAnnotation##name,
+KNOWN_ANNOTATIONS(X)
+#undef X
+    KnownAnnotationsCount
+} KnownAnnotation;
+
 const Node* lookup_annotation(const Node* decl, const char* name);
 const Node* lookup_annotation_list(Nodes, const char* name);
+const Node* lookup_known_annotation(const Node* decl, KnownAnnotation);
+const Node* lookup_known_annotation_list(Nodes, KnownAnnotation);
 const Node* get_annotation_value(const Node* annotation);
 Nodes get_annotation_values(const Node* annotation);
 /// Gets the string literal attached to an annotation, if present.
 const char* get_annotation_string_payload(const Node* annotation);
 bool lookup_annotation_with_string_payload(const Node* decl, const char* annotation_name, const char* expected_payload);
+bool lookup_known_annotation_with_string_payload(const Node* decl, KnownAnnotation, const char* expected_payload);
 bool is_annotation(const Node* node);
 String get_annotation_name(const Node* node);
 Nodes filter_out_annotation(IrArena*, Nodes, const char* name);
@@ -207,6 +246,15 @@ const Node* unit_type(IrArena* arena);
 
 //////////////////////////////// Compilation ////////////////////////////////
 
+/// Per-pass timings and IR arena statistics, see CompilerConfig.stats
+typedef struct CompilerStats_ CompilerStats;
+
+CompilerStats* new_compiler_stats();
+void destroy_compiler_stats(CompilerStats*);
+/// Human-readable table with one line per pass
+void print_compiler_stats(const CompilerStats*, FILE*);
+void compiler_stats_to_json(const CompilerStats*, char** str_ptr, size_t* size);
+
 typedef struct CompilerConfig_ {
     bool allow_frontend_syntax;
     bool dynamic_scheduling;
@@ -246,12 +294,24 @@ typedef struct CompilerConfig_ {
     struct {
         bool skip_generated, skip_builtin;
     } logging;
+
+    /// Type inference rewrites function bodies on this many threads, 0 keeps everything on the calling thread
+    /// The output is the same as the single-threaded one for any value.
+    size_t pass_threads;
+
+    /// Runs the lowering passes that have nothing to lower too, which should not change the output
+    bool disable_pass_skipping;
+
+    /// When set, run_compiler_passes records statistics about every pass in there
+    CompilerStats* stats;
 } CompilerConfig;
 
 CompilerConfig default_compiler_config();
 
 typedef enum CompilationResult_ {
-    CompilationNoError
+    CompilationNoError,
+    /// One of the input files could not be read
+    CompilationInputNotFound,
 } CompilationResult;
 
 CompilationResult parse_files(CompilerConfig*, size_t num_files, const char** file_names, const char** files_contents, Module* module);
@@ -281,4 +341,17 @@ void dump_module(Module*);
 void print_module_into_str(Module*, char** str_ptr, size_t*);
 void dump_node(const Node* node);
 
+//////////////////////////////// Tracing ////////////////////////////////
+
+/// Records Chrome trace events for the whole process into the file, it can be opened in chrome://tracing or ui.perfetto.dev
+/// The trace is finished by stop_tracing, or when the process exits.
+bool start_tracing(const char* filename);
+/// Must not race with traced work on other threads
+void stop_tracing();
+
+/// Opens a span on the calling thread, spans nest and are closed by trace_end. Names must be string literals or otherwise outlive the trace.
+void trace_begin(const char* name);
+void trace_end();
+void trace_counter(const char* name, uint64_t value);
+
 #endif
@@ -1,17 +1,30 @@
 #include "arena.h"
+#include "list.h"
 #include "portability.h"
 
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
 
-#define alloc_size 1024 * 1024
+/// the first block is kept small so that short-lived arenas stay cheap,
+/// every following block is twice as big as the previous one, up to max_block_size
+#define min_block_size (16 * 1024)
+#define max_block_size (16 * 1024 * 1024)
+
+typedef struct {
+    void* mem;
+    size_t size;
+    size_t used;
+} Block;
 
 typedef struct Arena_ {
-    int nblocks;
-    int maxblocks;
-    void** blocks;
-    size_t available;
+    /// blocks we bump-allocate from, only the last block in use has free space left
+    /// the ones after it are kept around by arena_reset, and get reused before mallocing more
+    struct List* blocks;
+    size_t blocks_in_use;
+    /// allocations too big to share a block, each gets its own
+    struct List* large;
+    size_t next_block_size;
 } Arena;
 
 inline static size_t round_up(size_t a, size_t b) {
@@ -22,46 +35,121 @@ inline static size_t round_up(size_t a, size_t b) {
 Arena* new_arena() {
     Arena* arena = malloc(sizeof(Arena));
     *arena = (Arena) {
-        .nblocks = 0,
-        .maxblocks = 256,
-        .blocks = malloc(256 * sizeof(size_t)),
-        .available = 0,
+        .blocks = new_list(Block),
+        .large = new_list(Block),
+        .next_block_size = min_block_size,
     };
-    for (int i = 0; i < arena->maxblocks; i++)
-        arena->blocks[i] = NULL;
     return arena;
 }
 
-void destroy_arena(Arena* arena) {
-    for (int i = 0; i < arena->nblocks; i++) {
-        free(arena->blocks[i]);
+static void free_blocks_from(struct List* list, size_t first) {
+    while (entries_count_list(list) > first) {
+        Block block = pop_last_list(Block, list);
+        free(block.mem);
     }
-    free(arena->blocks);
+}
+
+void destroy_arena(Arena* arena) {
+    free_blocks_from(arena->blocks, 0);
+    free_blocks_from(arena->large, 0);
+    destroy_list(arena->blocks);
+    destroy_list(arena->large);
     free(arena);
 }
 
-void* arena_alloc(Arena* arena, size_t size) {
+static Block* last_block(Arena* arena) {
+    if (arena->blocks_in_use == 0)
+        return NULL;
+    return &read_list(Block, arena->blocks)[arena->blocks_in_use - 1];
+}
+
+void* arena_alloc_uninit(Arena* arena, size_t size) {
     size = round_up(size, (size_t) sizeof(max_align_t));
     if (size == 0)
         return NULL;
-    // arena is full
-    if (size > arena->available) {
-        assert(arena->nblocks <= arena->maxblocks);
-        // we need more storage for the block pointers themselves !
-        if (arena->nblocks == arena->maxblocks) {
-            arena->maxblocks *= 2;
-            arena->blocks = realloc(arena->blocks, arena->maxblocks);
-        }
 
-        arena->blocks[arena->nblocks++] = malloc(alloc_size);
-        arena->available = alloc_size;
+    Block* block = last_block(arena);
+    if (block && block->size - block->used >= size) {
+        void* allocated = (void*) ((size_t) block->mem + block->used);
+        block->used += size;
+        return allocated;
     }
 
-    assert(size <= arena->available);
+    // anything taking up more than a quarter of a fresh block would waste too much of it, so it's allocated on its own
+    if (size > arena->next_block_size / 4) {
+        Block large = { .mem = malloc(size), .size = size, .used = size };
+        assert(large.mem);
+        append_list(Block, arena->large, large);
+        return large.mem;
+    }
 
-    size_t in_block = alloc_size - arena->available;
-    void* allocated = (void*) ((size_t) arena->blocks[arena->nblocks - 1] + in_block);
-    memset(allocated, 0, size);
-    arena->available -= size;
+    // recycle a spare block if one is big enough
+    while (arena->blocks_in_use < entries_count_list(arena->blocks)) {
+        block = &read_list(Block, arena->blocks)[arena->blocks_in_use++];
+        assert(block->used == 0);
+        if (block->size >= size) {
+            block->used = size;
+            return block->mem;
+        }
+    }
+
+    Block new_block = { .mem = malloc(arena->next_block_size), .size = arena->next_block_size, .used = size };
+    assert(new_block.mem);
+    append_list(Block, arena->blocks, new_block);
+    arena->blocks_in_use++;
+    if (arena->next_block_size < max_block_size)
+        arena->next_block_size *= 2;
+    return new_block.mem;
+}
+
+void* arena_alloc(Arena* arena, size_t size) {
+    void* allocated = arena_alloc_uninit(arena, size);
+    if (allocated)
+        memset(allocated, 0, size);
     return allocated;
 }
+
+ArenaCheckpoint arena_checkpoint(Arena* arena) {
+    Block* block = last_block(arena);
+    return (ArenaCheckpoint) {
+        .blocks = arena->blocks_in_use,
+        .used_in_last = block ? block->used : 0,
+        .large_blocks = entries_count_list(arena->large),
+    };
+}
+
+void arena_rewind(Arena* arena, ArenaCheckpoint checkpoint) {
+    assert(checkpoint.blocks <= arena->blocks_in_use);
+    assert(checkpoint.large_blocks <= entries_count_list(arena->large));
+    free_blocks_from(arena->blocks, checkpoint.blocks);
+    free_blocks_from(arena->large, checkpoint.large_blocks);
+    arena->blocks_in_use = checkpoint.blocks;
+    Block* block = last_block(arena);
+    if (block) {
+        assert(checkpoint.used_in_last <= block->used);
+        block->used = checkpoint.used_in_last;
+    }
+}
+
+void arena_reset(Arena* arena) {
+    free_blocks_from(arena->large, 0);
+    size_t count = entries_count_list(arena->blocks);
+    for (size_t i = 0; i < count; i++)
+        read_list(Block, arena->blocks)[i].used = 0;
+    arena->blocks_in_use = 0;
+}
+
+ArenaStats arena_stats(const Arena* arena) {
+    ArenaStats stats = { 0 };
+    struct List* lists[] = { arena->blocks, arena->large };
+    for (size_t l = 0; l < sizeof(lists) / sizeof(lists[0]); l++) {
+        size_t count = entries_count_list(lists[l]);
+        for (size_t i = 0; i < count; i++) {
+            Block block = read_list(Block, lists[l])[i];
+            stats.reserved += block.size;
+            stats.used += block.used;
+            stats.blocks++;
+        }
+    }
+    return stats;
+}
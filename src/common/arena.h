@@ -7,6 +7,37 @@ typedef struct Arena_ Arena;
 
 Arena* new_arena();
 void destroy_arena(Arena* arena);
+
+/// Returns zeroed memory, valid until the arena is destroyed or rewound past this point.
 void* arena_alloc(Arena* arena, size_t size);
+/// Like arena_alloc, but skips zeroing the memory: use it when the caller overwrites all of it anyway.
+void* arena_alloc_uninit(Arena* arena, size_t size);
+
+/// Marks the current fill level of an arena, see arena_rewind
+typedef struct {
+    size_t blocks;
+    size_t used_in_last;
+    size_t large_blocks;
+} ArenaCheckpoint;
+
+ArenaCheckpoint arena_checkpoint(Arena* arena);
+/// Frees everything allocated since the checkpoint was taken, in bulk.
+/// Checkpoints must be rewound in LIFO order.
+void arena_rewind(Arena* arena, ArenaCheckpoint checkpoint);
+
+/// Frees everything allocated so far, but keeps the memory blocks around to serve future allocations.
+/// Oversized allocations are given back to the system.
+void arena_reset(Arena* arena);
+
+typedef struct {
+    /// bytes obtained from malloc
+    size_t reserved;
+    /// bytes handed out to callers, including alignment padding
+    size_t used;
+    /// number of blocks, including the ones for oversized allocations
+    size_t blocks;
+} ArenaStats;
+
+ArenaStats arena_stats(const Arena* arena);
 
 #endif
@@ -1,10 +1,30 @@
 #include "dict.h"
+#include "portability.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
 
+// Open-addressing hash table in the style of "swiss tables":
+// buckets hold the key/value pairs and the full hash of the key, and a separate array of control bytes holds one byte of metadata per bucket.
+// A control byte is either empty, a thombstone, or the low 7 bits of the hash of the key in that bucket.
+// Lookups scan the control bytes a group at a time, using SIMD compares where available,
+// and only call cmp_fn on buckets whose control byte and full hash both match.
+// Since the hash is kept around, growing the table never calls hash_fn again.
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DICT_USE_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+#define DICT_USE_NEON
+#include <arm_neon.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 inline static size_t div_roundup(size_t a, size_t b) {
     //return (a + b - 1) / b;
     if (a % b == 0)
@@ -22,13 +42,21 @@ inline static size_t maxof(size_t a, size_t b) {
     return a > b ? a : b;
 }
 
-static size_t init_size = 32;
-
-struct BucketTag {
-    bool is_present;
-    bool is_thombstone;
+enum {
+    /// How many control bytes we look at in one go. The table size is always a power of two and a multiple of this.
+    GroupWidth = 16,
 };
 
+typedef int8_t CtrlByte;
+/// Bit i is set if the i-th control byte in a group matched
+typedef uint32_t GroupMask;
+
+static const CtrlByte ctrl_empty = -128;    // 0b10000000
+static const CtrlByte ctrl_thombstone = -2; // 0b11111110
+// a full bucket has the top bit cleared and the 7 low bits of the hash in the rest
+
+static size_t init_size = 32;
+
 struct Dict {
     size_t entries_count;
     size_t thombstones_count;
@@ -38,72 +66,162 @@ struct Dict {
     size_t value_size;
 
     size_t value_offset;
-    size_t tag_offset;
+    size_t hash_offset;
     size_t bucket_entry_size;
 
     KeyHash (*hash_fn) (void*);
     bool (*cmp_fn) (void*, void*);
+    /// set for new_ptr_dict/new_ptr_set: we then hash and compare keys inline instead of calling through the function pointers
+    bool is_identity;
+    CtrlByte* ctrl;
     void* alloc;
+
+    bool track_stats;
+    DictStats stats;
 };
 
+KeyHash hash_ptr(void** key) {
+    return (KeyHash) (size_t) *key;
+}
+
+bool compare_ptrs(void** a, void** b) {
+    return *a == *b;
+}
+
+inline static KeyHash dict_hash(const struct Dict* dict, void* key) {
+    if (dict->is_identity)
+        return (KeyHash) (size_t) *(void**) key;
+    return dict->hash_fn(key);
+}
+
+inline static bool dict_cmp(const struct Dict* dict, void* in_dict_key, void* key) {
+    if (dict->is_identity)
+        return *(void**) in_dict_key == *(void**) key;
+    return dict->cmp_fn(in_dict_key, key);
+}
+
+inline static GroupMask group_match_byte(const CtrlByte* group, CtrlByte b) {
+#if defined(DICT_USE_SSE2)
+    __m128i ctrl = _mm_loadu_si128((const __m128i*) group);
+    return (GroupMask) _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(b)));
+#elif defined(DICT_USE_NEON)
+    static const uint8_t bit_weights[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+    uint8x16_t matches = vceqq_s8(vld1q_s8(group), vdupq_n_s8(b));
+    uint8x16_t bits = vandq_u8(matches, vld1q_u8(bit_weights));
+    return (GroupMask) vaddv_u8(vget_low_u8(bits)) | ((GroupMask) vaddv_u8(vget_high_u8(bits)) << 8);
+#else
+    GroupMask mask = 0;
+    for (size_t i = 0; i < GroupWidth; i++)
+        mask |= (GroupMask) (group[i] == b) << i;
+    return mask;
+#endif
+}
+
+/// Empty and thombstone buckets are the only ones with the top bit set
+inline static GroupMask group_match_empty_or_thombstone(const CtrlByte* group) {
+#if defined(DICT_USE_SSE2)
+    return (GroupMask) _mm_movemask_epi8(_mm_loadu_si128((const __m128i*) group));
+#elif defined(DICT_USE_NEON)
+    static const uint8_t bit_weights[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+    uint8x16_t matches = vcltzq_s8(vld1q_s8(group));
+    uint8x16_t bits = vandq_u8(matches, vld1q_u8(bit_weights));
+    return (GroupMask) vaddv_u8(vget_low_u8(bits)) | ((GroupMask) vaddv_u8(vget_high_u8(bits)) << 8);
+#else
+    GroupMask mask = 0;
+    for (size_t i = 0; i < GroupWidth; i++)
+        mask |= (GroupMask) (group[i] < 0) << i;
+    return mask;
+#endif
+}
+
+inline static size_t lowest_set_bit(GroupMask mask) {
+    assert(mask);
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return (size_t) __builtin_ctz(mask);
+#endif
+}
+
+/// Spreads the entropy of the user-supplied hash, pointer-based hashes in particular have very regular low bits
+inline static uint64_t mix_hash(KeyHash hash) {
+    uint64_t h = hash;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/// The part of the hash that goes in the control bytes
+inline static CtrlByte hash_ctrl(uint64_t mixed) { return (CtrlByte) (mixed & 0x7F); }
+/// The part of the hash that picks the first group to probe
+inline static size_t hash_group(uint64_t mixed) { return (size_t) (mixed >> 7); }
+
+inline static void* bucket_key(const struct Dict* dict, size_t pos) {
+    return (void*) ((size_t) dict->alloc + pos * dict->bucket_entry_size);
+}
+
+inline static uint64_t* bucket_hash(const struct Dict* dict, size_t pos) {
+    return (uint64_t*) ((size_t) bucket_key(dict, pos) + dict->hash_offset);
+}
+
+inline static size_t max_load(size_t size) {
+    return size - size / 8;
+}
+
+static void alloc_buckets(struct Dict* dict, size_t size) {
+    assert(size % GroupWidth == 0 && (size & (size - 1)) == 0);
+    dict->size = size;
+    dict->ctrl = malloc(size);
+    memset(dict->ctrl, ctrl_empty, size);
+    dict->alloc = malloc(dict->bucket_entry_size * size);
+}
+
 struct Dict* new_dict_impl(size_t key_size, size_t value_size, size_t key_align, size_t value_align, KeyHash (*hash_fn)(void*), bool (*cmp_fn) (void*, void*)) {
     // offset of key is obviously zero
     size_t value_offset = align_offset(key_size, value_align);
-    size_t tag_offset = align_offset(value_offset + value_size, alignof(struct BucketTag));
-
-    size_t bucket_entry_size = tag_offset + sizeof(struct BucketTag);
+    size_t hash_offset = align_offset(value_offset + value_size, alignof(uint64_t));
+    size_t bucket_entry_size = hash_offset + sizeof(uint64_t);
 
     // Add extra padding at the end of each entry if required...
-    size_t max_align = maxof(maxof(key_align, value_align), alignof(struct BucketTag));
+    size_t max_align = maxof(maxof(key_align, value_align), alignof(uint64_t));
     bucket_entry_size = align_offset(bucket_entry_size, max_align);
 
     struct Dict* dict = (struct Dict*) malloc(sizeof(struct Dict));
     *dict = (struct Dict) {
         .entries_count = 0,
         .thombstones_count = 0,
-        .size = init_size,
 
         .key_size = key_size,
         .value_size = value_size,
 
         .value_offset = value_offset,
-        .tag_offset = tag_offset,
+        .hash_offset = hash_offset,
         .bucket_entry_size = bucket_entry_size,
 
         .hash_fn = hash_fn,
         .cmp_fn = cmp_fn,
-
-        .alloc = malloc(bucket_entry_size * init_size)
+        .is_identity = hash_fn == (HashFn) hash_ptr && cmp_fn == (CmpFn) compare_ptrs,
     };
-    // zero-init
-    memset(dict->alloc, 0, bucket_entry_size * init_size);
+    assert(!dict->is_identity || key_size == sizeof(void*));
+    alloc_buckets(dict, init_size);
     return dict;
 }
 
 struct Dict* clone_dict(struct Dict* source) {
     struct Dict* dict = (struct Dict*) malloc(sizeof(struct Dict));
-    *dict = (struct Dict) {
-        .entries_count = source->entries_count,
-        .thombstones_count = source->thombstones_count,
-        .size = source->size,
-
-        .key_size = source->key_size,
-        .value_size = source->value_size,
-
-        .value_offset = source->value_offset,
-        .tag_offset = source->tag_offset,
-        .bucket_entry_size = source->bucket_entry_size,
-
-        .hash_fn = source->hash_fn,
-        .cmp_fn = source->cmp_fn,
-
-        .alloc = malloc(source->bucket_entry_size * source->size)
-    };
+    *dict = *source;
+    dict->ctrl = malloc(source->size);
+    memcpy(dict->ctrl, source->ctrl, source->size);
+    dict->alloc = malloc(source->bucket_entry_size * source->size);
     memcpy(dict->alloc, source->alloc, source->bucket_entry_size * source->size);
     return dict;
 }
 
 void destroy_dict(struct Dict* dict) {
+    free(dict->ctrl);
     free(dict->alloc);
     free(dict);
 }
@@ -111,39 +229,79 @@ void destroy_dict(struct Dict* dict) {
 void clear_dict(struct Dict* dict) {
     dict->entries_count = 0;
     dict->thombstones_count = 0;
-    memset(dict->alloc, 0, dict->bucket_entry_size * dict->size);
+    memset(dict->ctrl, ctrl_empty, dict->size);
 }
 
 size_t entries_count_dict(struct Dict* dict) {
     return dict->entries_count;
 }
 
-void* find_key_dict_impl(struct Dict* dict, void* key) {
-    KeyHash hash = dict->hash_fn(key);
-    size_t pos = hash % dict->size;
-    const size_t init_pos = pos;
-    const size_t alloc_base = (size_t) dict->alloc;
-    while (true) {
-        size_t bucket = alloc_base + pos * dict->bucket_entry_size;
-
-        void* in_dict_key = (void*) bucket;
-        struct BucketTag* tag = (struct BucketTag*) (void*) (bucket + dict->tag_offset);
-        if (tag->is_present || tag->is_thombstone) {
-            // If the key is identical, we found our guy !
-            if (tag->is_present && dict->cmp_fn(in_dict_key, key))
-                return in_dict_key;
-
-            // Otherwise, do a crappy linear scan...
-            pos++;
-            if (pos == dict->size)
-                pos = 0;
-
-            // Make sure to die if we go full circle
-            if (pos == init_pos)
-                break;
-        } else break;
+DictStats dict_stats(const struct Dict* dict) {
+    return dict->stats;
+}
+
+void enable_dict_stats(struct Dict* dict) {
+    dict->track_stats = true;
+}
+
+static void count_lookup(struct Dict* dict, size_t groups_probed, size_t key_comparisons) {
+    if (!dict->track_stats)
+        return;
+    atomic_add_relaxed(&dict->stats.lookups, 1);
+    atomic_add_relaxed(&dict->stats.groups_probed, groups_probed);
+    atomic_add_relaxed(&dict->stats.key_comparisons, key_comparisons);
+}
+
+/// Returns the position of the bucket holding a key equal to `key`, or SIZE_MAX
+static size_t find_pos(struct Dict* dict, uint64_t mixed, void* key) {
+    const size_t groups_mask = dict->size / GroupWidth - 1;
+    const CtrlByte ctrl = hash_ctrl(mixed);
+    size_t group = hash_group(mixed) & groups_mask;
+    size_t groups_probed = 0, key_comparisons = 0;
+    // triangular probing visits every group once when the group count is a power of two
+    for (size_t stride = 1; stride <= groups_mask + 1; stride++) {
+        groups_probed++;
+        const CtrlByte* group_ctrl = dict->ctrl + group * GroupWidth;
+        GroupMask candidates = group_match_byte(group_ctrl, ctrl);
+        while (candidates) {
+            size_t pos = group * GroupWidth + lowest_set_bit(candidates);
+            if (*bucket_hash(dict, pos) == mixed) {
+                key_comparisons++;
+                if (dict_cmp(dict, bucket_key(dict, pos), key)) {
+                    count_lookup(dict, groups_probed, key_comparisons);
+                    return pos;
+                }
+            }
+            candidates &= candidates - 1;
+        }
+        // an empty bucket in this group means the key was never displaced further
+        if (group_match_byte(group_ctrl, ctrl_empty))
+            break;
+        group = (group + stride) & groups_mask;
     }
-    return NULL;
+    count_lookup(dict, groups_probed, key_comparisons);
+    return SIZE_MAX;
+}
+
+/// Returns the first bucket that is free for insertion along the probe sequence
+static size_t find_free_pos(struct Dict* dict, uint64_t mixed) {
+    const size_t groups_mask = dict->size / GroupWidth - 1;
+    size_t group = hash_group(mixed) & groups_mask;
+    for (size_t stride = 1; stride <= groups_mask + 1; stride++) {
+        GroupMask free = group_match_empty_or_thombstone(dict->ctrl + group * GroupWidth);
+        if (free)
+            return group * GroupWidth + lowest_set_bit(free);
+        group = (group + stride) & groups_mask;
+    }
+    assert(false && "the load factor should guarantee there is a free bucket");
+    return SIZE_MAX;
+}
+
+void* find_key_dict_impl(struct Dict* dict, void* key) {
+    size_t pos = find_pos(dict, mix_hash(dict_hash(dict, key)), key);
+    if (pos == SIZE_MAX)
+        return NULL;
+    return bucket_key(dict, pos);
 }
 
 void* find_value_dict_impl(struct Dict* dict, void* key) {
@@ -154,17 +312,20 @@ void* find_value_dict_impl(struct Dict* dict, void* key) {
 }
 
 bool remove_dict_impl(struct Dict* dict, void* key) {
-    void* found = find_key_dict_impl(dict, key);
-    if (found) {
-        struct BucketTag* tag = (void *) (((size_t) found) + dict->tag_offset);
-        assert(tag->is_present && !tag->is_thombstone);
-        tag->is_present = false;
-        tag->is_thombstone = true;
+    size_t pos = find_pos(dict, mix_hash(dict_hash(dict, key)), key);
+    if (pos == SIZE_MAX)
+        return false;
+    // If the group still has an empty bucket, it was never full, and no probe sequence went past it.
+    // We can then mark the bucket as empty instead of leaving a thombstone behind.
+    const CtrlByte* group_ctrl = dict->ctrl + (pos / GroupWidth) * GroupWidth;
+    if (group_match_byte(group_ctrl, ctrl_empty)) {
+        dict->ctrl[pos] = ctrl_empty;
+    } else {
+        dict->ctrl[pos] = ctrl_thombstone;
         dict->thombstones_count++;
-        dict->entries_count--;
-        return true;
     }
-    return false;
+    dict->entries_count--;
+    return true;
 }
 
 bool insert_dict_impl(struct Dict* dict, void* key, void* value, void** out_ptr);
@@ -185,152 +346,129 @@ void* insert_dict_and_get_value_impl(struct Dict* dict, void* key, void* value)
     return (void*) ((size_t)do_care + dict->value_offset);
 }
 
-static void rehash(struct Dict* dict, void* old_alloc, size_t old_size) {
+static void rehash(struct Dict* dict, CtrlByte* old_ctrl, void* old_alloc, size_t old_size) {
     const size_t alloc_base = (size_t) old_alloc;
     // Go over all the old entries and add them back
     for(size_t pos = 0; pos < old_size; pos++) {
-        size_t bucket = alloc_base + pos * dict->bucket_entry_size;
-
-        struct BucketTag* tag = (struct BucketTag*) (void*) (bucket + dict->tag_offset);
-        if (tag->is_present) {
-            void* key = (void*) bucket;
-            void* value = (void*) (bucket + dict->value_offset);
-            insert_dict_and_get_result_impl(dict, key, value);
-        }
+        if (old_ctrl[pos] < 0)
+            continue;
+        void* bucket = (void*) (alloc_base + pos * dict->bucket_entry_size);
+        uint64_t mixed = *(uint64_t*) ((size_t) bucket + dict->hash_offset);
+        size_t new_pos = find_free_pos(dict, mixed);
+        dict->ctrl[new_pos] = hash_ctrl(mixed);
+        memcpy(bucket_key(dict, new_pos), bucket, dict->bucket_entry_size);
+        dict->entries_count++;
     }
 }
 
-static void grow_and_rehash(struct Dict* dict) {
-    //printf("grow_rehash\n");
+static void resize_and_rehash(struct Dict* dict, size_t new_size) {
     size_t old_entries_count = entries_count_dict(dict);
 
+    CtrlByte* old_ctrl = dict->ctrl;
     void* old_alloc = dict->alloc;
     size_t old_size = dict->size;
 
     dict->entries_count = 0;
     dict->thombstones_count = 0;
-    dict->size *= 2;
-    dict->alloc = malloc(dict->size * dict->bucket_entry_size);
-    // zero-allocated so all the bucket flags are false
-    memset(dict->alloc, 0, dict->size * dict->bucket_entry_size);
+    dict->stats.rehashes++;
+    alloc_buckets(dict, new_size);
 
-    rehash(dict, old_alloc, old_size);
+    rehash(dict, old_ctrl, old_alloc, old_size);
     assert(old_entries_count == entries_count_dict(dict));
 
+    free(old_ctrl);
     free(old_alloc);
 }
 
-bool insert_dict_impl(struct Dict* dict, void* key, void* value, void** out_ptr) {
-    float load_factor = (float) (dict->entries_count + dict->thombstones_count) / (float) dict->size;
-    if (load_factor > 0.6)
-        grow_and_rehash(dict);
-
-    KeyHash hash = dict->hash_fn(key);
-    size_t pos = hash % dict->size;
-    const size_t init_pos = pos;
-    const size_t alloc_base = (size_t) dict->alloc;
-
-    enum { Inserting, Overwriting, Moving } mode;
-
-    size_t first_available_pos = SIZE_MAX;
-
-    // Find an empty spot...
-    while (true) {
-        size_t bucket = alloc_base + pos * dict->bucket_entry_size;
-
-        struct BucketTag tag = *(struct BucketTag*) (void*) (bucket + dict->tag_offset);
-        if (!tag.is_present) {
-            if (first_available_pos == SIZE_MAX)
-                first_available_pos = pos;
-            if (!tag.is_thombstone) {
-                mode = Inserting;
-                break;
-            }
-        } else {
-            void* in_dict_key = (void*) bucket;
-            if (dict->cmp_fn(in_dict_key, key)) {
-                if (first_available_pos == SIZE_MAX)
-                    first_available_pos = pos;
-                mode = (first_available_pos == pos) ? Overwriting : Moving;
-                break;
-            }
-        }
+static void grow_and_rehash(struct Dict* dict) {
+    // if we're mostly full of thombstones, we can just clean them up and keep the current size
+    size_t new_size = dict->size;
+    if (entries_count_dict(dict) >= max_load(dict->size) / 2)
+        new_size *= 2;
+    resize_and_rehash(dict, new_size);
+}
 
-        pos++;
-        if (pos == dict->size)
-            pos = 0;
-        if (pos == init_pos) {
-            assert(first_available_pos != SIZE_MAX);
-            mode = Inserting;
-            break;
-        }
-    }
-    assert(first_available_pos < dict->size);
-    assert(pos < dict->size);
-
-    size_t dst_bucket = alloc_base + first_available_pos * dict->bucket_entry_size;
-    struct BucketTag* dst_tag = (struct BucketTag*) (void*) (dst_bucket + dict->tag_offset);
-    void* in_dict_key = (void*) dst_bucket;
-    void* in_dict_value = (void*) (dst_bucket + dict->value_offset);
-
-    if (dst_tag->is_thombstone)
-        dict->thombstones_count--;
-
-    if (mode == Moving) {
-        size_t src_bucket = alloc_base + pos * dict->bucket_entry_size;
-        struct BucketTag* src_tag = (struct BucketTag*) (void*) (src_bucket + dict->tag_offset);
-        assert(src_tag->is_present && dst_tag->is_thombstone);
-        src_tag->is_thombstone = true;
-        src_tag->is_present = false;
-    } else if (mode == Overwriting) {
-        assert(dst_tag->is_present);
-    } else {
+void reserve_dict(struct Dict* dict, size_t entries) {
+    size_t new_size = dict->size;
+    while (max_load(new_size) < entries)
+        new_size *= 2;
+    if (new_size != dict->size)
+        resize_and_rehash(dict, new_size);
+}
+
+bool insert_dict_impl(struct Dict* dict, void* key, void* value, void** out_ptr) {
+    uint64_t mixed = mix_hash(dict_hash(dict, key));
+    size_t pos = find_pos(dict, mixed, key);
+    bool inserting = pos == SIZE_MAX;
+
+    if (inserting) {
+        if (dict->entries_count + dict->thombstones_count + 1 > max_load(dict->size))
+            grow_and_rehash(dict);
+
+        pos = find_free_pos(dict, mixed);
+        if (dict->ctrl[pos] == ctrl_thombstone)
+            dict->thombstones_count--;
+        dict->ctrl[pos] = hash_ctrl(mixed);
+        *bucket_hash(dict, pos) = mixed;
         dict->entries_count++;
     }
 
-    dst_tag->is_present = true;
-    dst_tag->is_thombstone = false;
+    void* in_dict_key = bucket_key(dict, pos);
+    void* in_dict_value = (void*) ((size_t) in_dict_key + dict->value_offset);
     memcpy(in_dict_key, key, dict->key_size);
     if (dict->value_size)
         memcpy(in_dict_value, value, dict->value_size);
     *out_ptr = in_dict_key;
 
-    return mode == Inserting;
+    return inserting;
 }
 
 bool dict_iter(struct Dict* dict, size_t* iterator_state, void* key, void* value) {
-    bool found_something = false;
-    while (!found_something) {
-        if (*iterator_state >= dict->size) {
-            return false;
-        }
-        const size_t alloc_base = (size_t) dict->alloc;
-        size_t bucket = alloc_base + (*iterator_state) * dict->bucket_entry_size;
-        struct BucketTag* tag = (struct BucketTag*) (void*) (bucket + dict->tag_offset);
-        if (tag->is_present) {
-            found_something = true;
-            void* in_dict_key = (void*) bucket;
-            if (key)
-                memcpy(key, in_dict_key, dict->key_size);
-            void* in_dict_value = (void*) (bucket + dict->value_offset);
-            if (value && dict->value_size > 0)
-                memcpy(value, in_dict_value, dict->value_size);
-        }
+    while (*iterator_state < dict->size && dict->ctrl[*iterator_state] < 0)
         (*iterator_state)++;
-    }
+    if (*iterator_state >= dict->size)
+        return false;
+
+    void* in_dict_key = bucket_key(dict, *iterator_state);
+    if (key)
+        memcpy(key, in_dict_key, dict->key_size);
+    void* in_dict_value = (void*) ((size_t) in_dict_key + dict->value_offset);
+    if (value && dict->value_size > 0)
+        memcpy(value, in_dict_value, dict->value_size);
+    (*iterator_state)++;
     return true;
 }
 
-#include "murmur3.h"
-
 KeyHash hash_murmur(const void* data, size_t size) {
-    int32_t out[4];
-    MurmurHash3_x64_128(data, (int) size, 0x1234567, &out);
-
-    uint32_t final = 0;
-    final ^= out[0];
-    final ^= out[1];
-    final ^= out[2];
-    final ^= out[3];
-    return final;
+    const uint64_t m = 0xc6a4a7935bd1e995ULL;
+    const int r = 47;
+
+    const unsigned char* bytes = (const unsigned char*) data;
+    uint64_t h = 0x1234567 ^ (size * m);
+
+    while (size >= sizeof(uint64_t)) {
+        uint64_t k;
+        memcpy(&k, bytes, sizeof(uint64_t));
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+
+        h ^= k;
+        h *= m;
+
+        bytes += sizeof(uint64_t);
+        size -= sizeof(uint64_t);
+    }
+
+    if (size > 0) {
+        uint64_t tail = 0;
+        memcpy(&tail, bytes, size);
+        h ^= tail;
+        h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return h;
 }
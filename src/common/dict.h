@@ -6,7 +6,7 @@
 #include <stdbool.h>
 #include <stdalign.h>
 
-typedef uint32_t KeyHash;
+typedef uint64_t KeyHash;
 typedef KeyHash (*HashFn)(void*);
 typedef bool (*CmpFn)(void*, void*);
 
@@ -16,14 +16,35 @@ struct Dict;
 #define new_set(K, hash, cmp) new_dict_impl(sizeof(K), 0, alignof(K), 0, hash, cmp)
 struct Dict* new_dict_impl(size_t key_size, size_t value_size, size_t key_align, size_t value_align, KeyHash (*)(void*), bool (*)(void*, void*));
 
+/// Identity-keyed flavour: keys are pointers that are hashed and compared by address, for things that are already unique (ie interned nodes)
+#define new_ptr_dict(K, T) new_dict(K, T, (HashFn) hash_ptr, (CmpFn) compare_ptrs)
+#define new_ptr_set(K) new_set(K, (HashFn) hash_ptr, (CmpFn) compare_ptrs)
+KeyHash hash_ptr(void**);
+bool compare_ptrs(void**, void**);
+
 struct Dict* clone_dict(struct Dict*);
 void destroy_dict(struct Dict*);
 void clear_dict(struct Dict*);
+/// Grows the dict so it can hold `entries` entries without rehashing, it never shrinks
+void reserve_dict(struct Dict*, size_t entries);
 
 bool dict_iter(struct Dict*, size_t* iterator_state, void* key, void* value);
 
 size_t entries_count_dict(struct Dict*);
 
+typedef struct {
+    size_t lookups;
+    /// groups of control bytes scanned, a lookup that finds its key straight away scans one
+    size_t groups_probed;
+    size_t key_comparisons;
+    size_t rehashes;
+} DictStats;
+
+DictStats dict_stats(const struct Dict*);
+/// Lookups are only counted once this is called, so that looking things up stays read-only otherwise and several threads
+/// can share a dict nobody inserts into. Once enabled, the counters are bumped atomically.
+void enable_dict_stats(struct Dict*);
+
 #define find_value_dict(K, T, dict, key) (T*) find_value_dict_impl(dict, (void*) (&(key)))
 #define find_key_dict(K, dict, key) (K*) find_key_dict_impl(dict, (void*) (&(key)))
 void* find_key_dict_impl(struct Dict*, void*);
@@ -44,6 +65,7 @@ void* insert_dict_and_get_key_impl(struct Dict*, void* key, void* value);
 #define      insert_set_get_result(K, dict, key)           insert_dict_and_get_result_impl(dict, (void*) (&(key)), NULL)
 bool insert_dict_and_get_result_impl(struct Dict*, void* key, void* value);
 
+/// MurmurHash64A, cheap on the small keys we typically deal with
 KeyHash hash_murmur(const void* data, size_t size);
 
 #endif
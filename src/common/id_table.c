@@ -0,0 +1,171 @@
+#include "id_table.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+
+enum {
+    PageBits = 8,
+    PageSize = 1 << PageBits,
+    PageMask = PageSize - 1,
+    PresenceWords = PageSize / 64,
+};
+
+typedef struct {
+    uint64_t present[PresenceWords];
+    /// PageSize values follow, none for sets
+} Page;
+
+struct IdTable {
+    size_t entries_count;
+    size_t value_size;
+    size_t pages_count;
+    Page** pages;
+};
+
+static size_t page_alloc_size(const struct IdTable* table) {
+    return sizeof(Page) + PageSize * table->value_size;
+}
+
+static void* page_value(const struct IdTable* table, Page* page, size_t index) {
+    return (void*) ((size_t) page + sizeof(Page) + index * table->value_size);
+}
+
+struct IdTable* new_id_table_impl(size_t value_size) {
+    struct IdTable* table = malloc(sizeof(struct IdTable));
+    *table = (struct IdTable) {
+        .entries_count = 0,
+        .value_size = value_size,
+        .pages_count = 0,
+        .pages = NULL,
+    };
+    return table;
+}
+
+struct IdTable* clone_id_table(const struct IdTable* source) {
+    struct IdTable* table = new_id_table_impl(source->value_size);
+    table->entries_count = source->entries_count;
+    table->pages_count = source->pages_count;
+    table->pages = calloc(source->pages_count, sizeof(Page*));
+    for (size_t i = 0; i < source->pages_count; i++) {
+        if (!source->pages[i])
+            continue;
+        table->pages[i] = malloc(page_alloc_size(source));
+        memcpy(table->pages[i], source->pages[i], page_alloc_size(source));
+    }
+    return table;
+}
+
+void destroy_id_table(struct IdTable* table) {
+    for (size_t i = 0; i < table->pages_count; i++)
+        free(table->pages[i]);
+    free(table->pages);
+    free(table);
+}
+
+void clear_id_table(struct IdTable* table) {
+    for (size_t i = 0; i < table->pages_count; i++) {
+        if (table->pages[i])
+            memset(table->pages[i]->present, 0, sizeof(table->pages[i]->present));
+    }
+    table->entries_count = 0;
+}
+
+size_t entries_count_id_table(const struct IdTable* table) {
+    return table->entries_count;
+}
+
+static Page* find_page(const struct IdTable* table, size_t id) {
+    size_t page = id >> PageBits;
+    return page < table->pages_count ? table->pages[page] : NULL;
+}
+
+static bool is_present(const Page* page, size_t index) {
+    return (page->present[index / 64] >> (index % 64)) & 1;
+}
+
+bool contains_id_table(const struct IdTable* table, size_t id) {
+    Page* page = find_page(table, id);
+    return page && is_present(page, id & PageMask);
+}
+
+void* find_value_id_table_impl(const struct IdTable* table, size_t id) {
+    assert(table->value_size > 0 && "use contains_id_table on sets");
+    Page* page = find_page(table, id);
+    if (!page || !is_present(page, id & PageMask))
+        return NULL;
+    return page_value(table, page, id & PageMask);
+}
+
+static Page* get_or_create_page(struct IdTable* table, size_t id) {
+    size_t page = id >> PageBits;
+    if (page >= table->pages_count) {
+        size_t new_count = table->pages_count ? table->pages_count : 4;
+        while (new_count <= page)
+            new_count *= 2;
+        table->pages = realloc(table->pages, new_count * sizeof(Page*));
+        memset(&table->pages[table->pages_count], 0, (new_count - table->pages_count) * sizeof(Page*));
+        table->pages_count = new_count;
+    }
+    if (!table->pages[page]) {
+        table->pages[page] = malloc(page_alloc_size(table));
+        memset(table->pages[page]->present, 0, sizeof(table->pages[page]->present));
+    }
+    return table->pages[page];
+}
+
+bool insert_id_table_impl(struct IdTable* table, size_t id, void* value) {
+    Page* page = get_or_create_page(table, id);
+    size_t index = id & PageMask;
+    if (is_present(page, index))
+        return false;
+    page->present[index / 64] |= (uint64_t) 1 << (index % 64);
+    if (table->value_size > 0) {
+        assert(value);
+        memcpy(page_value(table, page, index), value, table->value_size);
+    }
+    table->entries_count++;
+    return true;
+}
+
+bool remove_id_table(struct IdTable* table, size_t id) {
+    Page* page = find_page(table, id);
+    size_t index = id & PageMask;
+    if (!page || !is_present(page, index))
+        return false;
+    page->present[index / 64] &= ~((uint64_t) 1 << (index % 64));
+    table->entries_count--;
+    return true;
+}
+
+bool id_table_iter(const struct IdTable* table, size_t* iterator_state, size_t* id, void* value) {
+    size_t i = *iterator_state;
+    while ((i >> PageBits) < table->pages_count) {
+        Page* page = table->pages[i >> PageBits];
+        if (!page) {
+            i = ((i >> PageBits) + 1) << PageBits;
+            continue;
+        }
+        size_t index = i & PageMask;
+        // skip to the next present bit in this word, or to the next word
+        uint64_t word = page->present[index / 64] >> (index % 64);
+        if (!word) {
+            i = (i | 63) + 1;
+            continue;
+        }
+        while (!(word & 1)) {
+            word >>= 1;
+            i++;
+        }
+        index = i & PageMask;
+        if (id)
+            *id = i;
+        if (value && table->value_size > 0)
+            memcpy(value, page_value(table, page, index), table->value_size);
+        *iterator_state = i + 1;
+        return true;
+    }
+    *iterator_state = i;
+    return false;
+}
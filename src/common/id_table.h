@@ -0,0 +1,37 @@
+#ifndef SHADY_ID_TABLE_H
+#define SHADY_ID_TABLE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/// Side table indexed by small, dense ids (ie the ids of nodes in an IrArena), as an alternative to a dict when keys are numbered.
+/// The storage is split in pages that are only allocated once something is written to them, so a table that only cares about
+/// a few ids far apart stays small. The set flavour only keeps the bits saying which ids are present.
+struct IdTable;
+
+#define new_id_table(T) new_id_table_impl(sizeof(T))
+#define new_id_set() new_id_table_impl(0)
+struct IdTable* new_id_table_impl(size_t value_size);
+
+struct IdTable* clone_id_table(const struct IdTable*);
+void destroy_id_table(struct IdTable*);
+/// Forgets all the entries, but keeps the pages around for reuse
+void clear_id_table(struct IdTable*);
+
+size_t entries_count_id_table(const struct IdTable*);
+
+bool contains_id_table(const struct IdTable*, size_t id);
+#define find_value_id_table(T, table, id) (T*) find_value_id_table_impl(table, id)
+void* find_value_id_table_impl(const struct IdTable*, size_t id);
+
+/// Returns false (and leaves the table alone) if there was already an entry for that id
+#define insert_id_table(T, table, id, value) insert_id_table_impl(table, id, (void*) (&(value)))
+#define insert_id_set(table, id) insert_id_table_impl(table, id, NULL)
+bool insert_id_table_impl(struct IdTable*, size_t id, void* value);
+
+bool remove_id_table(struct IdTable*, size_t id);
+
+/// Goes over the entries in increasing id order, `id` and `value` may be NULL
+bool id_table_iter(const struct IdTable*, size_t* iterator_state, size_t* id, void* value);
+
+#endif
@@ -1,11 +1,19 @@
 #include "log.h"
+#include "portability.h"
 
 #include <stdio.h>
 #include <stdarg.h>
 
+/// process-wide default, only meant to be changed before spawning compiler threads
 LogLevel shady_log_level = INFO;
 
+/// per-thread override, so concurrent compilations can log at different levels
+static SHADY_THREAD_LOCAL bool thread_log_level_set = false;
+static SHADY_THREAD_LOCAL LogLevel thread_log_level;
+
 LogLevel get_log_level() {
+    if (thread_log_level_set)
+        return thread_log_level;
     return shady_log_level;
 }
 
@@ -13,10 +21,19 @@ void set_log_level(LogLevel l) {
     shady_log_level = l;
 }
 
+void set_thread_log_level(LogLevel l) {
+    thread_log_level = l;
+    thread_log_level_set = true;
+}
+
+void reset_thread_log_level() {
+    thread_log_level_set = false;
+}
+
 void log_string(LogLevel level, const char* format, ...) {
     va_list args;
     va_start(args, format);
-    if (level >= shady_log_level)
+    if (level >= get_log_level())
         vfprintf(stderr, format, args);
     va_end(args);
 }
@@ -2,6 +2,7 @@
 #define SHADY_LOG_H
 
 #include <stdio.h>
+#include <stdbool.h>
 
 typedef struct Node_ Node;
 typedef struct Module_ Module;
@@ -17,6 +18,9 @@ typedef enum LogLevel_ {
 
 LogLevel get_log_level();
 void set_log_level(LogLevel);
+/// Overrides the log level for the calling thread only
+void set_thread_log_level(LogLevel);
+void reset_thread_log_level();
 void log_string(LogLevel level, const char* format, ...);
 void log_node(LogLevel level, const Node* node);
 typedef struct CompilerConfig_ CompilerConfig;
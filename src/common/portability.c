@@ -1,3 +1,7 @@
+#include "portability.h"
+
+#include <stdbool.h>
+
 // Fix for allowing terminal colors on MINGW64
 // See: https://gist.github.com/fleroviux/8343879d95a72140274535dc207f467d
 #if defined(__MINGW32__)
@@ -23,3 +27,211 @@ void platform_specific_terminal_init_extras() {
     }
 #endif
 }
+
+#if defined(_WIN32)
+#include <windows.h>
+
+struct Thread_ {
+    HANDLE handle;
+    void (*fn)(void*);
+    void* user_data;
+};
+
+static DWORD WINAPI thread_trampoline(LPVOID param) {
+    Thread* thread = (Thread*) param;
+    thread->fn(thread->user_data);
+    return 0;
+}
+
+Thread* spawn_thread(void (*fn)(void*), void* user_data) {
+    Thread* thread = malloc(sizeof(Thread));
+    thread->fn = fn;
+    thread->user_data = user_data;
+    thread->handle = CreateThread(NULL, 0, thread_trampoline, thread, 0, NULL);
+    assert(thread->handle);
+    return thread;
+}
+
+void join_thread(Thread* thread) {
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    free(thread);
+}
+
+size_t get_hardware_concurrency() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+}
+
+uint64_t get_time_nano() {
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (uint64_t) ((double) counter.QuadPart * 1000000000.0 / (double) frequency.QuadPart);
+}
+
+size_t atomic_fetch_increment(size_t volatile* counter) {
+#if defined(_WIN64)
+    return (size_t) InterlockedIncrement64((LONG64 volatile*) counter) - 1;
+#else
+    return (size_t) InterlockedIncrement((LONG volatile*) counter) - 1;
+#endif
+}
+
+void atomic_add_relaxed(size_t volatile* counter, size_t value) {
+#if defined(_WIN64)
+    InterlockedExchangeAdd64((LONG64 volatile*) counter, (LONG64) value);
+#else
+    InterlockedExchangeAdd((LONG volatile*) counter, (LONG) value);
+#endif
+}
+
+struct Mutex_ {
+    CRITICAL_SECTION section;
+};
+
+Mutex* new_mutex() {
+    Mutex* mutex = malloc(sizeof(Mutex));
+    InitializeCriticalSection(&mutex->section);
+    return mutex;
+}
+
+void destroy_mutex(Mutex* mutex) {
+    DeleteCriticalSection(&mutex->section);
+    free(mutex);
+}
+
+void lock_mutex(Mutex* mutex) {
+    EnterCriticalSection(&mutex->section);
+}
+
+void unlock_mutex(Mutex* mutex) {
+    LeaveCriticalSection(&mutex->section);
+}
+
+static bool start_once(size_t volatile* state) {
+#if defined(_WIN64)
+    return InterlockedCompareExchange64((LONG64 volatile*) state, 1, 0) == 0;
+#else
+    return InterlockedCompareExchange((LONG volatile*) state, 1, 0) == 0;
+#endif
+}
+
+static void finish_once(size_t volatile* state) {
+    MemoryBarrier();
+    *state = 2;
+}
+
+static bool is_once_done(size_t volatile* state) {
+    bool done = *state == 2;
+    MemoryBarrier();
+    return done;
+}
+
+static void yield_thread() {
+    SwitchToThread();
+}
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+struct Thread_ {
+    pthread_t handle;
+    void (*fn)(void*);
+    void* user_data;
+};
+
+static void* thread_trampoline(void* param) {
+    Thread* thread = (Thread*) param;
+    thread->fn(thread->user_data);
+    return NULL;
+}
+
+Thread* spawn_thread(void (*fn)(void*), void* user_data) {
+    Thread* thread = malloc(sizeof(Thread));
+    thread->fn = fn;
+    thread->user_data = user_data;
+    SHADY_UNUSED int err = pthread_create(&thread->handle, NULL, thread_trampoline, thread);
+    assert(err == 0);
+    return thread;
+}
+
+void join_thread(Thread* thread) {
+    pthread_join(thread->handle, NULL);
+    free(thread);
+}
+
+size_t get_hardware_concurrency() {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (size_t) n : 1;
+}
+
+uint64_t get_time_nano() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000000 + (uint64_t) t.tv_nsec;
+}
+
+size_t atomic_fetch_increment(size_t volatile* counter) {
+    return __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+}
+
+void atomic_add_relaxed(size_t volatile* counter, size_t value) {
+    __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+struct Mutex_ {
+    pthread_mutex_t handle;
+};
+
+Mutex* new_mutex() {
+    Mutex* mutex = malloc(sizeof(Mutex));
+    pthread_mutex_init(&mutex->handle, NULL);
+    return mutex;
+}
+
+void destroy_mutex(Mutex* mutex) {
+    pthread_mutex_destroy(&mutex->handle);
+    free(mutex);
+}
+
+void lock_mutex(Mutex* mutex) {
+    pthread_mutex_lock(&mutex->handle);
+}
+
+void unlock_mutex(Mutex* mutex) {
+    pthread_mutex_unlock(&mutex->handle);
+}
+
+static bool start_once(size_t volatile* state) {
+    size_t expected = 0;
+    return __atomic_compare_exchange_n(state, &expected, 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+static void finish_once(size_t volatile* state) {
+    __atomic_store_n(state, 2, __ATOMIC_RELEASE);
+}
+
+static bool is_once_done(size_t volatile* state) {
+    return __atomic_load_n(state, __ATOMIC_ACQUIRE) == 2;
+}
+
+static void yield_thread() {
+    sched_yield();
+}
+#endif
+
+void run_once(Once* once, void (*fn)(void*), void* user_data) {
+    if (is_once_done(&once->state))
+        return;
+    if (start_once(&once->state)) {
+        fn(user_data);
+        finish_once(&once->state);
+        return;
+    }
+    while (!is_once_done(&once->state))
+        yield_thread();
+}
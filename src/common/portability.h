@@ -2,6 +2,7 @@
 #define SHADY_PORTABILITY
 
 #include <stdlib.h>
+#include <stdint.h>
 
 #include <assert.h>
 
@@ -12,6 +13,7 @@ static_assert(__STDC_VERSION__ >= 201112L, "C11 support is required to build sha
     #define LARRAY(T, name, size) T* name = alloca(sizeof(T) * (size))
     #define alloca _alloca
     #define SHADY_FALLTHROUGH
+    #define SHADY_THREAD_LOCAL __declspec(thread)
     // It's mid 2022, and this typedef is missing from <stdalign.h>
     // MSVC is not a real C11 compiler.
     typedef long long max_align_t;
@@ -23,8 +25,34 @@ static_assert(__STDC_VERSION__ >= 201112L, "C11 support is required to build sha
     #endif
     #define SHADY_UNUSED __attribute__((unused))
     #define SHADY_FALLTHROUGH __attribute__((fallthrough));
+    #define SHADY_THREAD_LOCAL _Thread_local
 #endif
 
 void platform_specific_terminal_init_extras();
 
+typedef struct Thread_ Thread;
+Thread* spawn_thread(void (*fn)(void*), void* user_data);
+/// Waits for the thread to finish and frees it
+void join_thread(Thread*);
+size_t get_hardware_concurrency();
+/// Monotonic clock, for measuring durations
+uint64_t get_time_nano();
+/// Atomically increments the counter and returns its previous value
+size_t atomic_fetch_increment(size_t volatile* counter);
+/// Atomically adds to the counter without ordering anything else, for statistics
+void atomic_add_relaxed(size_t volatile* counter, size_t value);
+
+typedef struct Mutex_ Mutex;
+Mutex* new_mutex();
+void destroy_mutex(Mutex*);
+void lock_mutex(Mutex*);
+void unlock_mutex(Mutex*);
+
+/// Lets exactly one thread run an initialisation function, the others wait for it to finish
+typedef struct {
+    size_t volatile state;
+} Once;
+#define ONCE_INIT { 0 }
+void run_once(Once*, void (*fn)(void*), void* user_data);
+
 #endif
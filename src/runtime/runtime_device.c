@@ -198,14 +198,6 @@ static bool get_physical_device_caps(SHADY_UNUSED Runtime* runtime, VkPhysicalDe
     return false;
 }
 
-KeyHash hash_program(Program** pdevice) {
-    return hash_murmur(*pdevice, sizeof(Device*));
-}
-
-bool cmp_programs(Device** pldevice, Device** prdevice) {
-    return *pldevice == *prdevice;
-}
-
 static void obtain_device_pointers(Device* device) {
 #define Y(fn_name) ext->fn_name = (PFN_##fn_name) vkGetDeviceProcAddr(device->device, #fn_name);
 #define X(_, prefix, name, fns) \
@@ -257,7 +249,7 @@ static Device* create_device(SHADY_UNUSED Runtime* runtime, VkPhysicalDevice phy
         .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT
     }, NULL, &device->cmd_pool), goto delete_device);
 
-    device->specialized_programs = new_dict(Program*, SpecProgram*, (HashFn) hash_program, (CmpFn) cmp_programs);
+    device->specialized_programs = new_ptr_dict(Program*, SpecProgram*);
 
     vkGetDeviceQueue(device->device, device->caps.compute_queue_family, 0, &device->compute_queue);
 
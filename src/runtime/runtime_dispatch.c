@@ -19,6 +19,7 @@ struct Dispatch_ {
 
 Dispatch* launch_kernel(Program* program, Device* device, int dimx, int dimy, int dimz, int args_count, void** args) {
     assert(program && device);
+    trace_begin("launch_kernel");
 
     Dispatch* dispatch = calloc(1, sizeof(Dispatch));
     dispatch->type = DispatchCompute;
@@ -32,14 +33,14 @@ Dispatch* launch_kernel(Program* program, Device* device, int dimx, int dimy, in
         .commandPool = device->cmd_pool,
         .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
         .commandBufferCount = 1
-    }, &dispatch->cmd_buf), return NULL);
+    }, &dispatch->cmd_buf), trace_end(); return NULL);
 
     CHECK_VK(vkBeginCommandBuffer(dispatch->cmd_buf, &(VkCommandBufferBeginInfo) {
         .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
         .pNext = NULL,
         .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
         .pInheritanceInfo = NULL
-    }), return NULL);
+    }), trace_end(); return NULL);
 
     EntryPointInfo entrypoint_info = dispatch->src->entrypoint;
     if (entrypoint_info.args_size) {
@@ -56,13 +57,13 @@ Dispatch* launch_kernel(Program* program, Device* device, int dimx, int dimy, in
     vkCmdBindPipeline(dispatch->cmd_buf, VK_PIPELINE_BIND_POINT_COMPUTE, dispatch->src->pipeline);
     vkCmdDispatch(dispatch->cmd_buf, dimx, dimy, dimz);
 
-    CHECK_VK(vkEndCommandBuffer(dispatch->cmd_buf), return NULL);
+    CHECK_VK(vkEndCommandBuffer(dispatch->cmd_buf), trace_end(); return NULL);
 
     CHECK_VK(vkCreateFence(device->device, &(VkFenceCreateInfo) {
         .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
         .pNext = NULL,
         .flags = 0
-    }, NULL, &dispatch->done_fence), return NULL);
+    }, NULL, &dispatch->done_fence), trace_end(); return NULL);
 
     CHECK_VK(vkQueueSubmit(device->compute_queue, 1, &(VkSubmitInfo) {
         .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
@@ -71,18 +72,21 @@ Dispatch* launch_kernel(Program* program, Device* device, int dimx, int dimy, in
         .commandBufferCount = 1,
         .pCommandBuffers = (VkCommandBuffer[]) { dispatch->cmd_buf },
         .signalSemaphoreCount = 0
-    }, dispatch->done_fence), return NULL);
+    }, dispatch->done_fence), trace_end(); return NULL);
 
+    trace_end();
     return dispatch;
 }
 
 bool wait_completion(Dispatch* dispatch) {
+    trace_begin("wait_completion");
     VkDevice device = dispatch->src->device->device;
-    CHECK_VK(vkWaitForFences(device, 1, (VkFence[]) { dispatch->done_fence }, true, UINT32_MAX), return false);
+    CHECK_VK(vkWaitForFences(device, 1, (VkFence[]) { dispatch->done_fence }, true, UINT32_MAX), trace_end(); return false);
 
     vkDestroyFence(device, dispatch->done_fence, NULL);
     vkFreeCommandBuffers(device, dispatch->src->device->cmd_pool, 1, &dispatch->cmd_buf);
 
     free(dispatch);
+    trace_end();
     return true;
 }
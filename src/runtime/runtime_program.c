@@ -13,6 +13,7 @@
 #include <stdlib.h>
 
 Program* load_program(Runtime* runtime, const char* program_src) {
+    trace_begin("load_program");
     Program* program = calloc(1, sizeof(Program));
     program->runtime = runtime;
 
@@ -20,11 +21,12 @@ Program* load_program(Runtime* runtime, const char* program_src) {
     config.allow_frontend_syntax = true;
     ArenaConfig arena_config = default_arena_config();
     program->arena = new_ir_arena(arena_config);
-    CHECK(program->arena != NULL, return false);
+    CHECK(program->arena != NULL, trace_end(); return false);
     program->generic_program = new_module(program->arena, "my_module");
-    CHECK(parse_files(&config, 1, NULL, (const char* []){ program_src }, program->generic_program) == CompilationNoError, return false);
+    CHECK(parse_files(&config, 1, NULL, (const char* []){ program_src }, program->generic_program) == CompilationNoError, trace_end(); return false);
     // TODO split the compilation pipeline into generic and non-generic parts
     append_list(Program*, runtime->programs, program);
+    trace_end();
     return program;
 }
 
@@ -46,7 +48,7 @@ static bool extract_entrypoint_info(const CompilerConfig* config, const Module*
 
         switch (node->tag) {
             case GlobalVariable_TAG: {
-                const Node* entry_point_args_annotation = lookup_annotation(node, "EntryPointArgs");
+                const Node* entry_point_args_annotation = lookup_known_annotation(node, KnownAnnotationEntryPointArgs);
                 if (entry_point_args_annotation) {
                     if (node->payload.global_variable.type->tag != RecordType_TAG) {
                         error_print("EntryPointArgs must be a struct\n");
@@ -64,7 +66,7 @@ static bool extract_entrypoint_info(const CompilerConfig* config, const Module*
                 break;
             }
             case Function_TAG: {
-                if (lookup_annotation(node, "EntryPoint")) {
+                if (lookup_known_annotation(node, KnownAnnotationEntryPoint)) {
                     if (node->payload.fun.params.count != 0) {
                         error_print("EntryPoint cannot have parameters\n");
                         return false;
@@ -156,13 +158,14 @@ static bool extract_layout(SpecProgram* program) {
 }
 
 static bool create_vk_pipeline(SpecProgram* program) {
+    trace_begin("create_vk_pipeline");
     CHECK_VK(vkCreateShaderModule(program->device->device, &(VkShaderModuleCreateInfo) {
         .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
         .pNext = NULL,
         .flags = 0,
         .codeSize = program->spirv_size,
         .pCode = (uint32_t*) program->spirv_bytes
-    }, NULL, &program->shader_module), return false);
+    }, NULL, &program->shader_module), trace_end(); return false);
 
     VkPipelineShaderStageCreateInfo stage_create_info = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
@@ -191,7 +194,8 @@ static bool create_vk_pipeline(SpecProgram* program) {
         .basePipelineIndex = -1,
         .layout = program->layout,
         .stage = stage_create_info,
-    } }, NULL, &program->pipeline), return false);
+    } }, NULL, &program->pipeline), trace_end(); return false);
+    trace_end();
     return true;
 }
 
@@ -260,12 +264,16 @@ static SpecProgram* create_specialized_program(Program* program, Device* device)
 }
 
 SpecProgram* get_specialized_program(Program* program, Device* device) {
+    trace_begin("get_specialized_program");
     SpecProgram** found = find_value_dict(Program*, SpecProgram*, device->specialized_programs, program);
-    if (found)
+    if (found) {
+        trace_end();
         return *found;
+    }
     SpecProgram* spec = create_specialized_program(program, device);
     assert(spec);
     insert_dict(Program*, SpecProgram*, device->specialized_programs, program, spec);
+    trace_end();
     return spec;
 }
 
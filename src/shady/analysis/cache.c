@@ -0,0 +1,174 @@
+#include "cache.h"
+
+#include "scope.h"
+#include "callgraph.h"
+#include "free_variables.h"
+
+#include "../ir_private.h"
+
+#include "list.h"
+#include "id_table.h"
+#include "portability.h"
+
+#include <stdlib.h>
+
+struct AnalysisCache_ {
+    /// worker threads of rewrite_module_parallel all query the module they read from
+    Mutex* lock;
+    /// both indexed by the NodeId of the abstraction
+    struct IdTable* scopes;
+    struct IdTable* free_variables;
+    CallGraph* callgraph;
+};
+
+AnalysisCache* new_analysis_cache() {
+    AnalysisCache* cache = malloc(sizeof(AnalysisCache));
+    *cache = (AnalysisCache) {
+        .lock = new_mutex(),
+        .scopes = new_id_table(Scope*),
+        .free_variables = new_id_table(struct List*),
+        .callgraph = NULL,
+    };
+    return cache;
+}
+
+static void drop_all_cached(AnalysisCache* cache) {
+    size_t i = 0;
+    Scope* scope;
+    while (id_table_iter(cache->scopes, &i, NULL, &scope))
+        destroy_scope(scope);
+    clear_id_table(cache->scopes);
+    i = 0;
+    struct List* free_variables;
+    while (id_table_iter(cache->free_variables, &i, NULL, &free_variables))
+        destroy_list(free_variables);
+    clear_id_table(cache->free_variables);
+    if (cache->callgraph)
+        destroy_callgraph(cache->callgraph);
+    cache->callgraph = NULL;
+}
+
+void destroy_analysis_cache(AnalysisCache* cache) {
+    drop_all_cached(cache);
+    destroy_id_table(cache->scopes);
+    destroy_id_table(cache->free_variables);
+    destroy_mutex(cache->lock);
+    free(cache);
+}
+
+static AnalysisCache* get_module_cache(const Module* mod) {
+    return mod->sealed ? mod->analyses : NULL;
+}
+
+Scope* get_scope(const Node* abstraction) {
+    AnalysisCache* cache = get_module_cache(get_abstraction_module(abstraction));
+    if (!cache)
+        return new_scope(abstraction);
+
+    lock_mutex(cache->lock);
+    Scope** found = find_value_id_table(Scope*, cache->scopes, abstraction->id);
+    Scope* scope = found ? *found : NULL;
+    unlock_mutex(cache->lock);
+    if (scope)
+        return scope;
+
+    // building the scope is the expensive bit, so it's done unlocked and the first one in wins
+    scope = new_scope(abstraction);
+    lock_mutex(cache->lock);
+    if (!insert_id_table(Scope*, cache->scopes, abstraction->id, scope)) {
+        destroy_scope(scope);
+        scope = *find_value_id_table(Scope*, cache->scopes, abstraction->id);
+    }
+    unlock_mutex(cache->lock);
+    return scope;
+}
+
+void release_scope(Scope* scope) {
+    const Node* abstraction = scope->entry->node;
+    AnalysisCache* cache = get_module_cache(get_abstraction_module(abstraction));
+    if (cache) {
+        lock_mutex(cache->lock);
+        Scope** found = find_value_id_table(Scope*, cache->scopes, abstraction->id);
+        bool cached = found && *found == scope;
+        unlock_mutex(cache->lock);
+        if (cached)
+            return;
+    }
+    destroy_scope(scope);
+}
+
+CallGraph* get_callgraph(Module* mod) {
+    AnalysisCache* cache = get_module_cache(mod);
+    if (!cache)
+        return new_callgraph(mod);
+
+    lock_mutex(cache->lock);
+    CallGraph* graph = cache->callgraph;
+    unlock_mutex(cache->lock);
+    if (graph)
+        return graph;
+
+    graph = new_callgraph(mod);
+    lock_mutex(cache->lock);
+    if (cache->callgraph) {
+        destroy_callgraph(graph);
+        graph = cache->callgraph;
+    } else {
+        cache->callgraph = graph;
+    }
+    unlock_mutex(cache->lock);
+    return graph;
+}
+
+void release_callgraph(Module* mod, CallGraph* graph) {
+    AnalysisCache* cache = get_module_cache(mod);
+    if (cache) {
+        lock_mutex(cache->lock);
+        bool cached = cache->callgraph == graph;
+        unlock_mutex(cache->lock);
+        if (cached)
+            return;
+    }
+    destroy_callgraph(graph);
+}
+
+struct List* get_free_variables(const Node* abstraction) {
+    AnalysisCache* cache = get_module_cache(get_abstraction_module(abstraction));
+    if (!cache) {
+        Scope* scope = new_scope(abstraction);
+        struct List* free_variables = compute_free_variables(scope);
+        destroy_scope(scope);
+        return free_variables;
+    }
+
+    lock_mutex(cache->lock);
+    struct List** found = find_value_id_table(struct List*, cache->free_variables, abstraction->id);
+    struct List* free_variables = found ? *found : NULL;
+    unlock_mutex(cache->lock);
+    if (free_variables)
+        return free_variables;
+
+    Scope* scope = get_scope(abstraction);
+    free_variables = compute_free_variables(scope);
+    release_scope(scope);
+    lock_mutex(cache->lock);
+    if (!insert_id_table(struct List*, cache->free_variables, abstraction->id, free_variables)) {
+        destroy_list(free_variables);
+        free_variables = *find_value_id_table(struct List*, cache->free_variables, abstraction->id);
+    }
+    unlock_mutex(cache->lock);
+    return free_variables;
+}
+
+void release_free_variables(const Node* abstraction, struct List* free_variables) {
+    AnalysisCache* cache = get_module_cache(get_abstraction_module(abstraction));
+    if (cache) {
+        lock_mutex(cache->lock);
+        struct List** found = find_value_id_table(struct List*, cache->free_variables, abstraction->id);
+        bool cached = found && *found == free_variables;
+        unlock_mutex(cache->lock);
+        if (cached)
+            return;
+    }
+    destroy_list(free_variables);
+}
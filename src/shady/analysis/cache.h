@@ -0,0 +1,28 @@
+#ifndef SHADY_ANALYSIS_CACHE_H
+#define SHADY_ANALYSIS_CACHE_H
+
+#include "shady/ir.h"
+
+typedef struct Scope_ Scope;
+typedef struct Callgraph_ CallGraph;
+
+/// Keeps the analyses of a module around, so the passes, the verifier and the emitters looking at the same module share them.
+/// Only sealed modules are cached: functions of a module that is still being built can change under our feet, so these get
+/// a fresh result every time. Sealed modules are immutable, so nothing cached for them ever needs to be invalidated. Either way, results are given back with the matching release function instead of being destroyed.
+typedef struct AnalysisCache_ AnalysisCache;
+
+AnalysisCache* new_analysis_cache();
+void destroy_analysis_cache(AnalysisCache*);
+
+/// Scope rooted at a function, basic block or lambda
+Scope* get_scope(const Node* abstraction);
+void release_scope(Scope*);
+
+CallGraph* get_callgraph(Module*);
+void release_callgraph(Module*, CallGraph*);
+
+/// Variables used in the scope of an abstraction without being bound inside of it, see compute_free_variables
+struct List* get_free_variables(const Node* abstraction);
+void release_free_variables(const Node* abstraction, struct List*);
+
+#endif
@@ -1,7 +1,7 @@
 #include "callgraph.h"
 
 #include "list.h"
-#include "dict.h"
+#include "id_table.h"
 
 #include "portability.h"
 #include "log.h"
@@ -11,19 +11,6 @@
 #include <stdlib.h>
 #include <assert.h>
 
-KeyHash hash_node(const Node**);
-bool compare_node(const Node**, const Node**);
-
-KeyHash hash_cgnode(CGNode** n) {
-    const Node* fn = (*n)->fn;
-    if (!fn) return 0;
-    return hash_node(&fn);
-
-}
-bool compare_cgnode(CGNode** a, CGNode** b) {
-    return (*a)->fn == (*b)->fn;
-}
-
 static CGNode* analyze_fn(CallGraph* graph, const Node* fn);
 
 typedef struct {
@@ -46,8 +33,8 @@ static void visit_node(CGVisitor* visitor, const Node* node) {
             // Immediate recursion
             if (target == visitor->node)
                 visitor->node->is_recursive = true;
-            insert_set_get_result(CGNode*, visitor->node->callees, target);
-            insert_set_get_result(CGNode*, target->callers, visitor->node);
+            insert_id_table(CGNode*, visitor->node->callees, target->fn->id, target);
+            insert_id_table(CGNode*, target->callers, visitor->node->fn->id, visitor->node);
             break;
         }
         case FnAddr_TAG: {
@@ -76,20 +63,21 @@ static void visit_node(CGVisitor* visitor, const Node* node) {
 
 static CGNode* analyze_fn(CallGraph* graph, const Node* fn) {
     assert(fn && fn->tag == Function_TAG);
-    CGNode** found = fn ? find_value_dict(const Node*, CGNode*, graph->fn2cgn, fn) : NULL;
+    CGNode** found = fn ? find_value_id_table(CGNode*, graph->fn2cgn, fn->id) : NULL;
     if (found)
         return *found;
     CGNode* new = calloc(1, sizeof(CGNode));
     new->fn = fn;
-    new->callees = new_set(CGNode*, (HashFn) hash_cgnode, (CmpFn) compare_cgnode);
-    new->callers = new_set(CGNode*, (HashFn) hash_cgnode, (CmpFn) compare_cgnode);
+    new->callees = new_id_table(CGNode*);
+    new->callers = new_id_table(CGNode*);
     new->tarjan.index = -1;
-    insert_dict_and_get_key(const Node*, CGNode*, graph->fn2cgn, fn, new);
+    insert_id_table(CGNode*, graph->fn2cgn, fn->id, new);
 
     CGVisitor v = {
         .visitor = {
             .visit_fn_scope_rpo = true,
-            .visit_fn = (VisitFn) visit_node
+            .visit_fn = (VisitFn) visit_node,
+            .worklist = true,
         },
         .graph = graph,
         .node = new,
@@ -128,8 +116,8 @@ static void strongconnect(CGNode* v, int* index, struct List* stack) {
     {
         size_t iter = 0;
         CGNode* w;
-        debugvv_print(" has %d successors\n", entries_count_dict(v->callees));
-        while (dict_iter(v->callees, &iter, &w, NULL)) {
+        debugvv_print(" has %d successors\n", entries_count_id_table(v->callees));
+        while (id_table_iter(v->callees, &iter, NULL, &w)) {
             debugvv_print("  %s\n", w->fn->payload.fun.name);
             if (w->tarjan.index == -1) {
                 // Successor w has not yet been visited; recurse on it
@@ -169,13 +157,13 @@ static void strongconnect(CGNode* v, int* index, struct List* stack) {
     }
 }
 
-static void tarjan(struct Dict* verts) {
+static void tarjan(struct IdTable* verts) {
     int index = 0;
     struct List* stack = new_list(CGNode*);
 
     size_t iter = 0;
     CGNode* n;
-    while (dict_iter(verts, &iter, NULL, &n)) {
+    while (id_table_iter(verts, &iter, NULL, &n)) {
         if (n->tarjan.index == -1)
             strongconnect(n, &index, stack);
     }
@@ -186,7 +174,7 @@ static void tarjan(struct Dict* verts) {
 CallGraph* new_callgraph(Module* mod) {
     CallGraph* graph = calloc(sizeof(CallGraph), 1);
     *graph = (CallGraph) {
-        .fn2cgn = new_dict(const Node*, CGNode*, (HashFn) hash_node, (CmpFn) compare_node)
+        .fn2cgn = new_id_table(CGNode*)
     };
 
     Nodes decls = get_module_declarations(mod);
@@ -196,7 +184,7 @@ CallGraph* new_callgraph(Module* mod) {
         }
     }
 
-    debugv_print("CallGraph: done with CFG build, contains %d nodes\n", entries_count_dict(graph->fn2cgn));
+    debugv_print("CallGraph: done with CFG build, contains %d nodes\n", entries_count_id_table(graph->fn2cgn));
 
     tarjan(graph->fn2cgn);
 
@@ -206,12 +194,12 @@ CallGraph* new_callgraph(Module* mod) {
 void destroy_callgraph(CallGraph* graph) {
     size_t i = 0;
     CGNode* node;
-    while (dict_iter(graph->fn2cgn, &i, NULL, &node)) {
+    while (id_table_iter(graph->fn2cgn, &i, NULL, &node)) {
         debugv_print("Freeing CG node: %s\n", node->fn->payload.fun.name);
-        destroy_dict(node->callers);
-        destroy_dict(node->callees);
+        destroy_id_table(node->callers);
+        destroy_id_table(node->callees);
         free(node);
     }
-    destroy_dict(graph->fn2cgn);
+    destroy_id_table(graph->fn2cgn);
     free(graph);
 }
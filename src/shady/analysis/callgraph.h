@@ -7,8 +7,9 @@ typedef struct CGNode_ CGNode;
 
 struct CGNode_ {
     const Node* fn;
-    struct Dict* callers;
-    struct Dict* callees;
+    /// both indexed by the NodeId of the other function
+    struct IdTable* callers;
+    struct IdTable* callees;
     struct {
         int index, lowlink;
         bool on_stack;
@@ -20,7 +21,8 @@ struct CGNode_ {
 };
 
 typedef struct Callgraph_ {
-    struct Dict* fn2cgn;
+    /// indexed by the NodeId of the function
+    struct IdTable* fn2cgn;
 } CallGraph;
 
 CallGraph* new_callgraph(Module*);
@@ -10,9 +10,6 @@
 
 #include <assert.h>
 
-KeyHash hash_node(Node**);
-bool compare_node(Node**, Node**);
-
 typedef struct {
     Visitor visitor;
     struct Dict* bound_set;
@@ -78,13 +75,14 @@ static void visit_domtree(Context* ctx, CFNode* cfnode, int depth) {
 }
 
 struct List* compute_free_variables(const Scope* scope) {
-    struct Dict* bound_set = new_set(const Node*, (HashFn) hash_node, (CmpFn) compare_node);
-    struct Dict* set = new_set(const Node*, (HashFn) hash_node, (CmpFn) compare_node);
+    struct Dict* bound_set = new_ptr_set(const Node*);
+    struct Dict* set = new_ptr_set(const Node*);
     struct List* free_list = new_list(const Node*);
 
     Context ctx = {
         .visitor = {
             .visit_fn = (VisitFn) visit_fv,
+            .worklist = true,
         },
         .bound_set = bound_set,
         .set = set,
@@ -0,0 +1,87 @@
+#include "module_features.h"
+
+#include "../ir_private.h"
+#include "../visit.h"
+
+#include "dict.h"
+#include "id_table.h"
+
+static ModuleFeatures node_features(const Node* node) {
+    switch (node->tag) {
+        case Int_TAG: return node->payload.int_type.width == IntTy64 ? FeatureInt64 : 0;
+        case IntLiteral_TAG: return node->payload.int_literal.width == IntTy64 ? FeatureInt64 : 0;
+        case PtrType_TAG: return node->payload.ptr_type.address_space == AsGeneric ? FeatureGenericPtrs : 0;
+        case PrimOp_TAG: switch (node->payload.prim_op.op) {
+            case subgroup_broadcast_first_op: return FeatureSubgroupOps;
+            default: return 0;
+        }
+        default: return 0;
+    }
+}
+
+ModuleFeatures scan_module_features(const Module* mod) {
+    IrArena* arena = get_module_arena(mod);
+    ModuleFeatures features = 0;
+    size_t i = 0;
+    const Node* node;
+    while (dict_iter(arena->node_set, &i, &node, NULL))
+        features |= node_features(node);
+    return features;
+}
+
+typedef struct {
+    Visitor visitor;
+    struct IdTable* seen;
+} ReferencesVisitor;
+
+static void visit_decl_annotations(ReferencesVisitor* v, const Node* decl) {
+    switch (decl->tag) {
+        case Function_TAG: visit_nodes(&v->visitor, decl->payload.fun.annotations); break;
+        case Constant_TAG: visit_nodes(&v->visitor, decl->payload.constant.annotations); break;
+        case GlobalVariable_TAG: visit_nodes(&v->visitor, decl->payload.global_variable.annotations); break;
+        case NominalType_TAG: visit_nodes(&v->visitor, decl->payload.nom_type.annotations); break;
+        default: break;
+    }
+}
+
+static void visit_references(ReferencesVisitor* v, const Node* node) {
+    // the IR is hash-consed, shared nodes only need looking at once
+    if (!insert_id_set(v->seen, node->id))
+        return;
+    if (is_declaration(node))
+        visit_decl_annotations(v, node);
+    visit_children(&v->visitor, node);
+}
+
+bool has_unreferenced_nominal_types(const Module* mod) {
+    Nodes decls = get_module_declarations(mod);
+    size_t nominal_types_count = 0;
+    for (size_t i = 0; i < decls.count; i++) {
+        if (decls.nodes[i]->tag == NominalType_TAG)
+            nominal_types_count++;
+    }
+    if (nominal_types_count == 0)
+        return false;
+
+    // like rewrite_module, start from everything but the nominal types, and follow the references to other declarations
+    ReferencesVisitor v = {
+        .visitor = {
+            .visit_fn = (VisitFn) visit_references,
+            .visit_fn_scope_rpo = true,
+            .visit_referenced_decls = true,
+            .worklist = true,
+        },
+        .seen = new_id_set(),
+    };
+    for (size_t i = 0; i < decls.count; i++) {
+        if (decls.nodes[i]->tag != NominalType_TAG)
+            visit_references(&v, decls.nodes[i]);
+    }
+    bool unreferenced = false;
+    for (size_t i = 0; i < decls.count; i++) {
+        if (decls.nodes[i]->tag == NominalType_TAG && !contains_id_table(v.seen, decls.nodes[i]->id))
+            unreferenced = true;
+    }
+    destroy_id_table(v.seen);
+    return unreferenced;
+}
@@ -0,0 +1,28 @@
+#ifndef SHADY_MODULE_FEATURES_H
+#define SHADY_MODULE_FEATURES_H
+
+#include "shady/ir.h"
+
+#include <stdint.h>
+
+/// Constructs a lowering pass may have to rewrite, passes that only touch those can be skipped when none are present
+typedef enum {
+    /// 64-bit integer types
+    FeatureInt64          = 1 << 0,
+    /// pointers into the generic address space
+    FeatureGenericPtrs    = 1 << 1,
+    /// subgroup primops that may need emulating
+    FeatureSubgroupOps    = 1 << 2,
+} ModuleFeature;
+
+typedef uint32_t ModuleFeatures;
+
+/// Conservatively computes the features used in the arena a module lives in
+/// This walks the arena's interned nodes instead of the module itself, so it might report features dead code uses.
+ModuleFeatures scan_module_features(const Module*);
+
+/// Whether some nominal types of the module are not referenced from anything else in it.
+/// Rewriting a module only keeps the nominal types it comes across, so no pass is an identity rewrite of such a module.
+bool has_unreferenced_nominal_types(const Module*);
+
+#endif
@@ -2,7 +2,7 @@
 #include "log.h"
 
 #include "list.h"
-#include "dict.h"
+#include "id_table.h"
 #include "arena.h"
 
 #include <stdlib.h>
@@ -22,19 +22,17 @@ struct List* build_scopes(Module* mod) {
     return scopes;
 }
 
-KeyHash hash_node(const Node**);
-bool compare_node(const Node**, const Node**);
-
 typedef struct {
     Arena* arena;
     const Node* entry;
-    struct Dict* nodes;
+    struct IdTable* nodes;
     struct List* queue;
     struct List* contents;
 } ScopeBuildContext;
 
 CFNode* scope_lookup(Scope* scope, const Node* block) {
-    CFNode** found = find_value_dict(const Node*, CFNode*, scope->map, block);
+    assert(block->arena == scope->entry->node->arena);
+    CFNode** found = find_value_id_table(CFNode*, scope->map, block->id);
     if (found) return *found;
     assert(false);
 }
@@ -42,7 +40,7 @@ CFNode* scope_lookup(Scope* scope, const Node* block) {
 static CFNode* get_or_enqueue(ScopeBuildContext* ctx, const Node* abs) {
     assert(is_abstraction(abs));
     assert(!is_function(abs) || abs == ctx->entry);
-    CFNode** found = find_value_dict(const Node*, CFNode*, ctx->nodes, abs);
+    CFNode** found = find_value_id_table(CFNode*, ctx->nodes, abs->id);
     if (found) return *found;
 
     CFNode* new = arena_alloc(ctx->arena, sizeof(CFNode));
@@ -54,7 +52,7 @@ static CFNode* get_or_enqueue(ScopeBuildContext* ctx, const Node* abs) {
         .idom = NULL,
         .dominates = NULL,
     };
-    insert_dict(const Node*, CFNode*, ctx->nodes, abs, new);
+    insert_id_table(CFNode*, ctx->nodes, abs->id, new);
     append_list(Node*, ctx->queue, new);
     append_list(Node*, ctx->contents, new);
     return new;
@@ -154,7 +152,7 @@ Scope* new_scope(const Node* entry) {
     ScopeBuildContext context = {
         .arena = arena,
         .entry = entry,
-        .nodes = new_dict(const Node*, CFNode*, (HashFn) hash_node, (CmpFn) compare_node),
+        .nodes = new_id_table(CFNode*),
         .queue = new_list(CFNode*),
         .contents = new_list(CFNode*),
     };
@@ -192,7 +190,7 @@ void destroy_scope(Scope* scope) {
         if (node->dominates)
             destroy_list(node->dominates);
     }
-    destroy_dict(scope->map);
+    destroy_id_table(scope->map);
     destroy_arena(scope->arena);
     free(scope->rpo);
     destroy_list(scope->contents);
@@ -213,6 +211,26 @@ static size_t post_order_visit(Scope* scope, CFNode* n, size_t i) {
     return n->rpo_index;
 }
 
+/// Lays the edges out by rpo_index, either forwards or backwards
+static CFAdjacency build_adjacency(Scope* scope, bool preds) {
+    size_t* offsets = arena_alloc_uninit(scope->arena, sizeof(size_t) * (scope->size + 1));
+    offsets[0] = 0;
+    for (size_t i = 0; i < scope->size; i++) {
+        CFNode* n = scope->rpo[i];
+        offsets[i + 1] = offsets[i] + entries_count_list(preds ? n->pred_edges : n->succ_edges);
+    }
+    size_t* indices = arena_alloc_uninit(scope->arena, sizeof(size_t) * offsets[scope->size]);
+    for (size_t i = 0; i < scope->size; i++) {
+        CFNode* n = scope->rpo[i];
+        struct List* edges = preds ? n->pred_edges : n->succ_edges;
+        for (size_t j = 0; j < entries_count_list(edges); j++) {
+            CFEdge edge = read_list(CFEdge, edges)[j];
+            indices[offsets[i] + j] = (preds ? edge.src : edge.dst)->rpo_index;
+        }
+    }
+    return (CFAdjacency) { .offsets = offsets, .indices = indices };
+}
+
 void compute_rpo(Scope* scope) {
     scope->rpo = malloc(sizeof(const CFNode*) * scope->size);
     size_t index = post_order_visit(scope,  scope->entry, scope->size);
@@ -223,51 +241,137 @@ void compute_rpo(Scope* scope) {
     //     debug_print("%s, ", scope->rpo[i]->node->payload.lam.name);
     // }
     // debug_print("\n");
+
+    scope->succs = build_adjacency(scope, false);
+    scope->preds = build_adjacency(scope, true);
 }
 
-CFNode* least_common_ancestor(CFNode* i, CFNode* j) {
-    assert(i && j);
-    while (i->rpo_index != j->rpo_index) {
-        while (i->rpo_index < j->rpo_index) j = j->idom;
-        while (i->rpo_index > j->rpo_index) i = i->idom;
+enum {
+    NoNode = SIZE_MAX
+};
+
+typedef struct {
+    size_t* preorder;
+    /// the following are all indexed by preorder number
+    size_t* vertex;
+    size_t* parent;
+    size_t* semi;
+    size_t* label;
+    size_t* ancestor;
+    size_t* idom;
+    /// scratch space for the DFS and path compression
+    size_t* stack;
+    size_t* cursor;
+} DomContext;
+
+/// Walks up the (linked part of the) DFS tree from v, keeping the node with the smallest semidominator in label[].
+/// Iterative so that long chains of blocks don't blow the C stack.
+static void compress(DomContext* ctx, size_t v) {
+    size_t top = 0;
+    while (ctx->ancestor[ctx->ancestor[v]] != NoNode) {
+        ctx->stack[top++] = v;
+        v = ctx->ancestor[v];
+    }
+    while (top > 0) {
+        size_t u = ctx->stack[--top];
+        size_t a = ctx->ancestor[u];
+        if (ctx->semi[ctx->label[a]] < ctx->semi[ctx->label[u]])
+            ctx->label[u] = ctx->label[a];
+        ctx->ancestor[u] = ctx->ancestor[a];
     }
-    return i;
 }
 
-void compute_domtree(Scope* scope) {
-    for (size_t i = 1; i < scope->size; i++) {
-        CFNode* n = read_list(CFNode*, scope->contents)[i];
-        for (size_t j = 0; j < entries_count_list(n->pred_edges); j++) {
-            CFEdge e = read_list(CFEdge, n->pred_edges)[j];
-            CFNode* p = e.src;
-            if (p->rpo_index < n->rpo_index) {
-                n->idom = p;
-                goto outer_loop;
-            }
+/// Semi-NCA (Georgiadis et al.): semidominators as in Lengauer-Tarjan, then idoms as nearest common ancestors in the DFS tree.
+/// Fills idoms[] with the immediate dominator of every node, or NoNode for the root and nodes it does not reach.
+static void compute_idoms(size_t count, size_t root, const CFAdjacency* succs, const CFAdjacency* preds, size_t* idoms) {
+    size_t* storage = malloc(sizeof(size_t) * count * 9);
+    DomContext ctx = {
+        .preorder = storage,
+        .vertex   = storage + count * 1,
+        .parent   = storage + count * 2,
+        .semi     = storage + count * 3,
+        .label    = storage + count * 4,
+        .ancestor = storage + count * 5,
+        .idom     = storage + count * 6,
+        .stack    = storage + count * 7,
+        .cursor   = storage + count * 8,
+    };
+
+    for (size_t v = 0; v < count; v++) {
+        ctx.preorder[v] = NoNode;
+        idoms[v] = NoNode;
+    }
+
+    // number the nodes in DFS preorder
+    size_t reached = 0;
+    size_t top = 0;
+    ctx.preorder[root] = reached;
+    ctx.vertex[reached] = root;
+    ctx.parent[reached++] = NoNode;
+    ctx.cursor[root] = succs->offsets[root];
+    ctx.stack[top++] = root;
+    while (top > 0) {
+        size_t v = ctx.stack[top - 1];
+        if (ctx.cursor[v] == succs->offsets[v + 1]) {
+            top--;
+            continue;
         }
-        error("no idom found");
-        outer_loop:;
+        size_t w = succs->indices[ctx.cursor[v]++];
+        if (ctx.preorder[w] != NoNode)
+            continue;
+        ctx.preorder[w] = reached;
+        ctx.vertex[reached] = w;
+        ctx.parent[reached++] = ctx.preorder[v];
+        ctx.cursor[w] = succs->offsets[w];
+        ctx.stack[top++] = w;
     }
 
-    bool todo = true;
-    while (todo) {
-        todo = false;
-        for (size_t i = 1; i < scope->size; i++) {
-            CFNode* n = read_list(CFNode*, scope->contents)[i];
-            CFNode* new_idom = NULL;
-            for (size_t j = 0; j < entries_count_list(n->pred_edges); j++) {
-                CFEdge e = read_list(CFEdge, n->pred_edges)[j];
-                CFNode* p = e.src;
-                new_idom = new_idom ? least_common_ancestor(new_idom, p) : p;
-            }
-            assert(new_idom);
-            if (n->idom != new_idom) {
-                n->idom = new_idom;
-                todo = true;
+    for (size_t i = 0; i < reached; i++) {
+        ctx.semi[i] = i;
+        ctx.label[i] = i;
+        ctx.ancestor[i] = NoNode;
+    }
+
+    for (size_t w = reached - 1; w > 0; w--) {
+        size_t v = ctx.vertex[w];
+        for (size_t j = preds->offsets[v]; j < preds->offsets[v + 1]; j++) {
+            size_t p = ctx.preorder[preds->indices[j]];
+            if (p == NoNode)
+                continue;
+            size_t u = p;
+            if (ctx.ancestor[p] != NoNode) {
+                compress(&ctx, p);
+                u = ctx.label[p];
             }
+            if (ctx.semi[u] < ctx.semi[w])
+                ctx.semi[w] = ctx.semi[u];
         }
+        ctx.ancestor[w] = ctx.parent[w];
+    }
+
+    ctx.idom[0] = NoNode;
+    for (size_t w = 1; w < reached; w++) {
+        size_t d = ctx.parent[w];
+        while (d > ctx.semi[w])
+            d = ctx.idom[d];
+        ctx.idom[w] = d;
+        idoms[ctx.vertex[w]] = ctx.vertex[d];
     }
 
+    free(storage);
+}
+
+void compute_domtree(Scope* scope) {
+    size_t* idoms = malloc(sizeof(size_t) * scope->size);
+    compute_idoms(scope->size, 0, &scope->succs, &scope->preds, idoms);
+    for (size_t i = 1; i < scope->size; i++) {
+        CFNode* n = scope->rpo[i];
+        if (idoms[i] == NoNode)
+            error("no idom found");
+        n->idom = scope->rpo[idoms[i]];
+    }
+    free(idoms);
+
     for (size_t i = 0; i < scope->size; i++) {
         CFNode* n = read_list(CFNode*, scope->contents)[i];
         n->dominates = new_list(CFNode*);
@@ -278,11 +382,7 @@ void compute_domtree(Scope* scope) {
     }
 }
 
-static int extra_uniqueness = 0;
-
 static void dump_cfg_scope(FILE* output, Scope* scope) {
-    extra_uniqueness++;
-
     const Node* entry = scope->entry->node;
     fprintf(output, "subgraph cluster_%s {\n", get_abstraction_name(entry));
     fprintf(output, "label = \"%s\";\n", get_abstraction_name(entry));
@@ -33,15 +33,25 @@ struct CFNode_ {
     struct List* dominates;
 };
 
+/// Edges laid out in compressed rows: the neighbours of the node with rpo_index i are the rpo indices
+/// indices[offsets[i]] up to (but not including) indices[offsets[i + 1]]
+typedef struct {
+    size_t* offsets;
+    size_t* indices;
+} CFAdjacency;
+
 typedef struct Arena_ Arena;
 typedef struct Scope_ {
     Arena* arena;
     size_t size;
     struct List* contents;
-    struct Dict* map;
+    /// CFNodes indexed by the NodeId of their abstraction
+    struct IdTable* map;
     CFNode* entry;
     // set by compute_rpo
     CFNode** rpo;
+    CFAdjacency succs;
+    CFAdjacency preds;
 } Scope;
 
 struct List* build_scopes(Module*);
@@ -6,7 +6,7 @@
 #include "../visit.h"
 #include "../ir_private.h"
 
-#include "dict.h"
+#include "id_table.h"
 #include "list.h"
 
 #include <assert.h>
@@ -14,20 +14,16 @@
 typedef struct {
     Visitor visitor;
     const IrArena* arena;
-    struct Dict* once;
+    struct IdTable* once;
 } ArenaVerifyVisitor;
 
 static void visit_verify_same_arena(ArenaVerifyVisitor* visitor, const Node* node) {
     assert(visitor->arena == node->arena);
-    if (find_key_dict(const Node*, visitor->once, node))
+    if (!insert_id_set(visitor->once, node->id))
         return;
-    insert_set_get_result(const Node*, visitor->once, node);
     visit_children(&visitor->visitor, node);
 }
 
-KeyHash hash_node(const Node**);
-bool compare_node(const Node**, const Node**);
-
 static void verify_same_arena(Module* mod) {
     const IrArena* arena = get_module_arena(mod);
     ArenaVerifyVisitor visitor = {
@@ -40,12 +36,13 @@ static void verify_same_arena(Module* mod) {
             // but rather because we might in a program that isn't.
             .visit_referenced_decls = true,
             .visit_continuations = true,
+            .worklist = true,
         },
         .arena = arena,
-        .once = new_set(const Node*, (HashFn) hash_node, (CmpFn) compare_node)
+        .once = new_id_set()
     };
     visit_module(&visitor.visitor, mod);
-    destroy_dict(visitor.once);
+    destroy_id_table(visitor.once);
 }
 
 static void verify_scoping(Module* mod) {
@@ -26,16 +26,19 @@ String get_annotation_name(const Node* node) {
     }
 }
 
-static const Node* search_annotations(const Node* decl, const char* name, size_t* i) {
+static const Nodes* get_decl_annotations(const Node* decl) {
     assert(decl);
-    const Nodes* annotations = NULL;
     switch (decl->tag) {
-        case Function_TAG: annotations = &decl->payload.fun.annotations; break;
-        case GlobalVariable_TAG: annotations = &decl->payload.global_variable.annotations; break;
-        case Constant_TAG: annotations = &decl->payload.constant.annotations; break;
-        case NominalType_TAG: annotations = &decl->payload.nom_type.annotations; break;
+        case Function_TAG: return &decl->payload.fun.annotations;
+        case GlobalVariable_TAG: return &decl->payload.global_variable.annotations;
+        case Constant_TAG: return &decl->payload.constant.annotations;
+        case NominalType_TAG: return &decl->payload.nom_type.annotations;
         default: error("Not a declaration")
     }
+}
+
+static const Node* search_annotations(const Node* decl, const char* name, size_t* i) {
+    const Nodes* annotations = get_decl_annotations(decl);
 
     while (*i < annotations->count) {
         const Node* annotation = annotations->nodes[*i];
@@ -62,6 +65,23 @@ const Node* lookup_annotation_list(Nodes annotations, const char* name) {
     return NULL;
 }
 
+/// Names are interned, so telling whether an annotation is a known one is a pointer comparison
+static bool is_known_annotation(const Node* annotation, KnownAnnotation known) {
+    return get_annotation_name(annotation) == annotation->arena->known_annotation_names[known];
+}
+
+const Node* lookup_known_annotation_list(Nodes annotations, KnownAnnotation known) {
+    for (size_t i = 0; i < annotations.count; i++) {
+        if (is_known_annotation(annotations.nodes[i], known))
+            return annotations.nodes[i];
+    }
+    return NULL;
+}
+
+const Node* lookup_known_annotation(const Node* decl, KnownAnnotation known) {
+    return lookup_known_annotation_list(*get_decl_annotations(decl), known);
+}
+
 const Node* get_annotation_value(const Node* annotation) {
     assert(annotation);
     if (annotation->tag != AnnotationValue_TAG)
@@ -95,6 +115,15 @@ bool lookup_annotation_with_string_payload(const Node* decl, const char* annotat
     }
 }
 
+bool lookup_known_annotation_with_string_payload(const Node* decl, KnownAnnotation known, const char* expected_payload) {
+    Nodes annotations = *get_decl_annotations(decl);
+    for (size_t i = 0; i < annotations.count; i++) {
+        if (is_known_annotation(annotations.nodes[i], known) && strcmp(get_annotation_string_payload(annotations.nodes[i]), expected_payload) == 0)
+            return true;
+    }
+    return false;
+}
+
 Nodes filter_out_annotation(IrArena* arena, Nodes annotations, const char* name) {
     LARRAY(const Node*, new_annotations, annotations.count);
     size_t new_count = 0;
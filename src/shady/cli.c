@@ -75,6 +75,15 @@ void parse_common_args(int* pargc, char** argv) {
                 error_print("\n");
                 exit(IncorrectLogLevel);
             }
+        } else if (strcmp(argv[i], "--trace") == 0) {
+            argv[i] = NULL;
+            i++;
+            if (i == argc) {
+                error_print("--trace must be followed with a filename");
+                exit(MissingTraceArg);
+            }
+            if (!start_tracing(argv[i]))
+                exit(MissingTraceArg);
         } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
             help = true;
             continue;
@@ -86,6 +95,7 @@ void parse_common_args(int* pargc, char** argv) {
 
     if (help) {
         error_print("  --log-level debug[v[v]], info, warn, error]\n");
+        error_print("  --trace <filename>                        Records a Chrome trace of the compiler (and runtime) phases\n");
     }
 
     pack_remaining_args(pargc, argv);
@@ -106,6 +116,16 @@ void parse_compiler_config_args(CompilerConfig* config, int* pargc, char** argv)
             config->logging.skip_builtin = false;
         } else if (strcmp(argv[i], "--print-generated") == 0) {
             config->logging.skip_generated = false;
+        } else if (strcmp(argv[i], "--pass-threads") == 0) {
+            argv[i] = NULL;
+            i++;
+            char* end = NULL;
+            long threads = i < argc ? strtol(argv[i], &end, 10) : 0;
+            if (i >= argc || *end != '\0' || threads < 0) {
+                error_print("--pass-threads expects a thread count, use 0 to disable threading");
+                exit(InvalidJobCount);
+            }
+            config->pass_threads = (size_t) threads;
         } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
             help = true;
             continue;
@@ -120,6 +140,7 @@ void parse_compiler_config_args(CompilerConfig* config, int* pargc, char** argv)
         error_print("  --print-generated                         Includes generated functions in the debug output\n");
         error_print("  --no-dynamic-scheduling                   Disable the built-in dynamic scheduler, restricts code to only leaf functions\n");
         error_print("  --simt2d                                  Emits SIMD code instead of SIMT, only effective with the C backend.\n");
+        error_print("  --pass-threads <n>                        Infers types in function bodies on <n> threads\n");
     }
 
     pack_remaining_args(pargc, argv);
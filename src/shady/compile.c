@@ -6,7 +6,9 @@
 #include "transform/internal_constants.h"
 #include "portability.h"
 #include "ir_private.h"
+#include "rewrite.h"
 #include "util.h"
+#include "list.h"
 
 #include <stdbool.h>
 
@@ -54,6 +56,26 @@ ArenaConfig default_arena_config() {
     };
 }
 
+static bool arena_config_eq(const ArenaConfig* a, const ArenaConfig* b) {
+    return a->name_bound == b->name_bound
+        && a->check_types == b->check_types
+        && a->allow_fold == b->allow_fold
+        && a->is_simt == b->is_simt
+        && a->subgroup_mask_representation == b->subgroup_mask_representation
+        && a->memory.ptr_size == b->memory.ptr_size
+        && a->memory.word_size == b->memory.word_size;
+}
+
+bool can_skip_pass(const CompilerConfig* config, const Module* mod, ArenaConfig aconfig, ModuleFeatures required) {
+    if (config->disable_pass_skipping)
+        return false;
+    if (!arena_config_eq(&get_module_arena(mod)->config, &aconfig))
+        return false;
+    if (scan_module_features(mod) & required)
+        return false;
+    return !has_unreferenced_nominal_types(mod);
+}
+
 #define mod (*pmod)
 
 CompilationResult run_compiler_passes(CompilerConfig* config, Module** pmod) {
@@ -62,7 +84,10 @@ CompilationResult run_compiler_passes(CompilerConfig* config, Module** pmod) {
 
     IrArena* old_arena = NULL;
     IrArena* tmp_arena = NULL;
+    IrArena* spare_arena = NULL;
+    uint64_t pass_start;
 
+    trace_begin("run_compiler_passes");
     generate_dummy_constants(config, mod);
 
     aconfig.name_bound = true;
@@ -98,28 +123,71 @@ CompilationResult run_compiler_passes(CompilerConfig* config, Module** pmod) {
     aconfig.subgroup_mask_representation = SubgroupMaskInt64;
     RUN_PASS(lower_mask)
     RUN_PASS(lower_memcpy)
-    RUN_PASS(lower_subgroup_ops)
+    RUN_PASS_REQUIRING(lower_subgroup_ops, FeatureSubgroupOps)
     RUN_PASS(lower_stack)
 
     RUN_PASS(lower_lea)
-    RUN_PASS(lower_generic_ptrs)
+    RUN_PASS_REQUIRING(lower_generic_ptrs, FeatureGenericPtrs)
     RUN_PASS(lower_physical_ptrs)
     RUN_PASS(lower_subgroup_vars)
     RUN_PASS(lower_memory_layout)
 
-    RUN_PASS(lower_int)
+    // without int64 emulation there is nothing for this pass to do at all
+    RUN_PASS_REQUIRING(lower_int, config->lower.int64 ? FeatureInt64 : 0)
 
     if (config->lower.simt_to_explicit_simd) {
         aconfig.is_simt = false;
         RUN_PASS(simt2d)
     }
 
+    if (spare_arena)
+        destroy_ir_arena(spare_arena);
+
+    trace_end();
     return CompilationNoError;
 }
 
 #undef mod
 
+typedef struct {
+    Once once;
+    ParserConfig pconfig;
+    Module* module;
+} ParsedBuiltin;
+
+/// The builtin scheduler is only tokenized and parsed once per process (per front-end syntax setting),
+/// compilations then import the parsed declarations into their own module.
+static ParsedBuiltin parsed_scheduler[2] = {
+    { .once = ONCE_INIT, .pconfig = { .front_end = false } },
+    { .once = ONCE_INIT, .pconfig = { .front_end = true } },
+};
+
+static void parse_builtin_scheduler(void* user_data) {
+    ParsedBuiltin* builtin = (ParsedBuiltin*) user_data;
+    debugv_print("Parsing builtin scheduler code");
+    // this arena lives for as long as the process does
+    IrArena* arena = new_ir_arena(default_arena_config());
+    builtin->module = new_module(arena, "builtin_scheduler");
+    parse(builtin->pconfig, shady_scheduler_src, builtin->module);
+    // intern the declarations list now, importers then only ever read from this arena
+    get_module_declarations(builtin->module);
+    builtin->module->sealed = true;
+}
+
+static void import_builtin_scheduler(CompilerConfig* config, Module* mod) {
+    ParsedBuiltin* builtin = &parsed_scheduler[config->allow_frontend_syntax ? 1 : 0];
+    run_once(&builtin->once, parse_builtin_scheduler, builtin);
+
+    // unbound code refers to declarations by name, so nominal types need to be imported explicitly too
+    Rewriter importer = create_importer(builtin->module, mod);
+    size_t count = entries_count_list(builtin->module->decls);
+    for (size_t i = 0; i < count; i++)
+        rewrite_node_with_fn(&importer, read_list(const Node*, builtin->module->decls)[i], importer.rewrite_field_type.rewrite_decl);
+    destroy_rewriter(&importer);
+}
+
 CompilationResult parse_files(CompilerConfig* config, size_t num_files, const char** file_names, const char** files_contents, Module* mod) {
+    trace_begin("parse_files");
     ParserConfig pconfig = {
         .front_end = config->allow_frontend_syntax
     };
@@ -149,11 +217,10 @@ CompilationResult parse_files(CompilerConfig* config, size_t num_files, const ch
             } else {
                 assert(file_names);
                 bool ok = read_file(file_names[i], NULL, &file_contents);
-                assert(ok);
-
-                if (file_contents == NULL) {
-                    error_print("file does not exist\n");
-                    exit(InputFileDoesNotExist);
+                if (!ok || file_contents == NULL) {
+                    error_print("could not read '%s'\n", file_names[i]);
+                    trace_end();
+                    return CompilationInputNotFound;
                 }
             }
 
@@ -166,13 +233,9 @@ CompilationResult parse_files(CompilerConfig* config, size_t num_files, const ch
         }
     }
 
-    if (config->dynamic_scheduling) {
-        debugv_print("Parsing builtin scheduler code");
-        parse(pconfig, shady_scheduler_src, mod);
-    }
-
-    // Free the read files
-    for (size_t i = 0; i < num_files; i++)
+    if (config->dynamic_scheduling)
+        import_builtin_scheduler(config, mod);
 
+    trace_end();
     return CompilationNoError;
 }
@@ -5,6 +5,9 @@
 #include "passes/passes.h"
 #include "log.h"
 #include "analysis/verify.h"
+#include "analysis/module_features.h"
+#include "stats.h"
+#include "portability.h"
 
 #ifdef NDEBUG
 #define SHADY_RUN_VERIFY 0
@@ -12,17 +15,42 @@
 #define SHADY_RUN_VERIFY 1
 #endif
 
-#define RUN_PASS(pass_name)                             \
-old_mod = mod;                                          \
-old_arena = tmp_arena;                                  \
-tmp_arena = new_ir_arena(aconfig);                      \
-mod = new_module(tmp_arena, get_module_name(old_mod));  \
-pass_name(config, old_mod, mod);                        \
-debug_print("After "#pass_name" pass: \n");             \
-log_module(DEBUG, config, mod);                         \
-if (SHADY_RUN_VERIFY)                                   \
-verify_module(mod);                                     \
-mod->sealed = true;                                     \
-if (old_arena) destroy_ir_arena(old_arena);
+/// The arena a pass consumed is kept in `spare_arena` and recycled by the next one, callers destroy it when done.
+#define RUN_PASS(pass_name)                                                 \
+trace_begin(#pass_name);                                                    \
+old_mod = mod;                                                              \
+old_arena = tmp_arena;                                                      \
+tmp_arena = reuse_ir_arena(spare_arena, aconfig, get_module_arena(mod));    \
+spare_arena = NULL;                                                         \
+mod = new_module(tmp_arena, get_module_name(old_mod));                      \
+if (config->stats)                                                          \
+enable_ir_arena_stats(tmp_arena);                                           \
+pass_start = config->stats ? get_time_nano() : 0;                           \
+pass_name(config, old_mod, mod);                                            \
+if (config->stats)                                                          \
+record_pass_stats(config->stats, #pass_name,                                \
+                  get_time_nano() - pass_start,                             \
+                  tmp_arena);                                               \
+debug_print("After "#pass_name" pass: \n");                                 \
+log_module(DEBUG, config, mod);                                             \
+mod->sealed = true;                                                         \
+if (SHADY_RUN_VERIFY)                                                       \
+verify_module(mod);                                                         \
+trace_ir_arenas_size(old_arena, tmp_arena);                                 \
+spare_arena = old_arena;                                                    \
+trace_end();
+
+/// Checks whether a pass that only rewrites constructs in `required` would be an identity rewrite of `mod`.
+/// This is also only true when no change to the arena config is still pending, since those are applied by running a pass,
+/// and when the module has no unreferenced nominal types, since running the pass would drop them.
+bool can_skip_pass(const CompilerConfig* config, const Module* mod, ArenaConfig aconfig, ModuleFeatures required);
+
+/// Same as RUN_PASS, but keeps the current module when it uses none of the features the pass lowers
+#define RUN_PASS_REQUIRING(pass_name, required)                         \
+if (can_skip_pass(config, mod, aconfig, required)) {                    \
+    debugv_print("Skipping "#pass_name" pass: nothing to lower\n");    \
+} else {                                                                \
+    RUN_PASS(pass_name)                                                 \
+}
 
 #endif
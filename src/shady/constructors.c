@@ -41,22 +41,31 @@ static void intern_strings(IrArena* arena, Node* node) {
     }
 }
 
+KeyHash hash_node_contents(const Node* node);
+
 static Node* create_node_helper(IrArena* arena, Node node) {
     intern_strings(arena, &node);
+    node.hash = hash_node_contents(&node);
 
     Node* ptr = &node;
+    lock_ir_arena(arena);
     Node** found = find_key_dict(Node*, arena->node_set, ptr);
+    Node* existing = found ? *found : NULL;
+    unlock_ir_arena(arena);
     // sanity check nominal nodes to be unique, check for duplicates in structural nodes
     if (is_nominal(&node))
-        assert(!found);
-    else if (found)
-        return *found;
+        assert(!existing);
+    else if (existing)
+        return existing;
 
+    // folding builds more nodes, so the arena can't be locked during it
     if (arena->config.allow_fold) {
         Node* folded = (Node*) fold_node(arena, ptr);
         if (folded != ptr) {
             // The folding process simplified the node, we store a mapping to that simplified node and bail out !
+            lock_ir_arena(arena);
             insert_set_get_result(Node*, arena->node_set, folded);
+            unlock_ir_arena(arena);
             return folded;
         }
     }
@@ -64,10 +73,26 @@ static Node* create_node_helper(IrArena* arena, Node node) {
     if (arena->config.check_types && node.type)
         assert(is_type(node.type));
 
+    lock_ir_arena(arena);
+    // another thread might have interned the same node in the meantime
+    if (!is_nominal(&node) && arena->lock) {
+        found = find_key_dict(Node*, arena->node_set, ptr);
+        if (found) {
+            existing = *found;
+            unlock_ir_arena(arena);
+            return existing;
+        }
+    }
+
     // place the node in the arena and return it
-    Node* alloc = (Node*) arena_alloc(arena->arena, sizeof(Node));
-    *alloc = node;
+    Node* alloc = (Node*) arena_alloc_uninit(arena->arena, node_alloc_size(node.tag));
+    memcpy(alloc, &node, node_alloc_size(node.tag));
+    assign_node_id(arena, alloc);
+    // nominal nodes are hashed by address, which we only know now
+    if (is_nominal(alloc))
+        alloc->hash = hash_node_contents(alloc);
     insert_set_get_result(const Node*, arena->node_set, alloc);
+    unlock_ir_arena(arena);
 
     return alloc;
 }
@@ -248,6 +273,45 @@ const Node* lambda(Module* module, Nodes params, const Node* body) {
     return create_node_helper(arena, node);
 }
 
+Node* deferred_lambda(Module* module, Nodes params) {
+    assert(!module->sealed);
+    IrArena* arena = get_module_arena(module);
+    AnonLambda payload = {
+        .module = module,
+        .params = params,
+        .body = NULL,
+    };
+
+    Node node;
+    memset((void*) &node, 0, sizeof(Node));
+    node = (Node) {
+        .arena = arena,
+        .type = arena->config.check_types ? check_type_anon_lam(arena, payload) : NULL,
+        .tag = AnonLambda_TAG,
+        .payload.anon_lam = payload
+    };
+
+    lock_ir_arena(arena);
+    Node* alloc = (Node*) arena_alloc_uninit(arena->arena, node_alloc_size(AnonLambda_TAG));
+    memcpy(alloc, &node, node_alloc_size(AnonLambda_TAG));
+    assign_node_id(arena, alloc);
+    unlock_ir_arena(arena);
+    return alloc;
+}
+
+void finish_deferred_lambda(Node* lam, const Node* body) {
+    assert(lam->tag == AnonLambda_TAG && !lam->payload.anon_lam.body);
+    IrArena* arena = lam->arena;
+    lam->payload.anon_lam.body = body;
+    lam->hash = hash_node_contents(lam);
+    // this one is referenced already so it has to stay distinct, but if a structurally identical lambda was interned first
+    // that one stays the canonical one: inserting would overwrite the key other lookups already resolved to
+    lock_ir_arena(arena);
+    if (!find_key_dict(Node*, arena->node_set, lam))
+        insert_set_get_result(Node*, arena->node_set, lam);
+    unlock_ir_arena(arena);
+}
+
 Node* constant(Module* mod, Nodes annotations, const Type* hint, String name) {
     IrArena* arena = mod->arena;
     Constant cnst = {
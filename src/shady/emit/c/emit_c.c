@@ -536,9 +536,6 @@ CType* lookup_existing_type(Emitter* emitter, const Type* node) {
     return found;
 }
 
-KeyHash hash_node(Node**);
-bool compare_node(Node**, Node**);
-
 static Module* run_backend_specific_passes(SHADY_UNUSED CEmitterConfig* econfig, Module* mod) {
     // CompilerConfig* config = econfig->config;
     // IrArena* old_arena = get_module_arena(mod);
@@ -553,6 +550,7 @@ static Module* run_backend_specific_passes(SHADY_UNUSED CEmitterConfig* econfig,
 }
 
 void emit_c(CEmitterConfig config, Module* mod, size_t* output_size, char** output, Module** new_mod) {
+    trace_begin("emit_c");
     IrArena* initial_arena = get_module_arena(mod);
     mod = run_backend_specific_passes(&config, mod);
     IrArena* arena = get_module_arena(mod);
@@ -567,8 +565,8 @@ void emit_c(CEmitterConfig config, Module* mod, size_t* output_size, char** outp
         .type_decls = open_growy_as_printer(type_decls_g),
         .fn_decls = open_growy_as_printer(fn_decls_g),
         .fn_defs = open_growy_as_printer(fn_defs_g),
-        .emitted_terms = new_dict(Node*, CTerm, (HashFn) hash_node, (CmpFn) compare_node),
-        .emitted_types = new_dict(Node*, String, (HashFn) hash_node, (CmpFn) compare_node),
+        .emitted_terms = new_ptr_dict(Node*, CTerm),
+        .emitted_types = new_ptr_dict(Node*, String),
     };
 
     Nodes decls = get_module_declarations(mod);
@@ -631,4 +629,5 @@ void emit_c(CEmitterConfig config, Module* mod, size_t* output_size, char** outp
         *new_mod = mod;
     else if (initial_arena != arena)
         destroy_ir_arena(arena);
+    trace_end();
 }
@@ -80,7 +80,7 @@ String emit_fn_head(Emitter* emitter, const Node* fn_type, String center, const
 
     String c_decl = emit_type(emitter, wrap_multiple_yield_types(emitter->arena, codom), center);
 
-    const Node* entry_point = fn ? lookup_annotation(fn, "EntryPoint") : NULL;
+    const Node* entry_point = fn ? lookup_known_annotation(fn, KnownAnnotationEntryPoint) : NULL;
     if (entry_point) switch (emitter->config.dialect) {
             case C:
                 break;
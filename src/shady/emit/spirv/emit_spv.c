@@ -5,6 +5,7 @@
 
 #include "../../ir_private.h"
 #include "../../analysis/scope.h"
+#include "../../analysis/cache.h"
 
 #include "../../compile.h"
 
@@ -282,7 +283,7 @@ static void emit_function(Emitter* emitter, const Node* node) {
     }
 
     if (node->payload.fun.body) {
-        Scope* scope = new_scope(node);
+        Scope* scope = get_scope(node);
         // reserve a bunch of identifiers for the basic blocks in the scope
         for (size_t i = 0; i < scope->size; i++) {
             CFNode* cfnode = read_list(CFNode*, scope->contents)[i];
@@ -317,7 +318,7 @@ static void emit_function(Emitter* emitter, const Node* node) {
             emit_basic_block(emitter, fn_builder, scope, cfnode);
         }
 
-        destroy_scope(scope);
+        release_scope(scope);
 
         spvb_define_function(emitter->file_builder, fn_builder);
     } else
@@ -349,8 +350,8 @@ SpvId emit_decl(Emitter* emitter, const Node* decl) {
                 case SpvStorageClassStorageBuffer:
                 case SpvStorageClassUniform:
                 case SpvStorageClassUniformConstant: {
-                    const Node* descriptor_set = lookup_annotation(decl, "DescriptorSet");
-                    const Node* descriptor_binding = lookup_annotation(decl, "DescriptorBinding");
+                    const Node* descriptor_set = lookup_known_annotation(decl, KnownAnnotationDescriptorSet);
+                    const Node* descriptor_binding = lookup_known_annotation(decl, KnownAnnotationDescriptorBinding);
                     assert(descriptor_set && descriptor_binding && "DescriptorSet and/or DescriptorBinding annotations are missing");
                     size_t set     = get_int_literal_value(get_annotation_value(descriptor_set),     false);
                     size_t binding = get_int_literal_value(get_annotation_value(descriptor_binding), false);
@@ -433,7 +434,7 @@ static void emit_entry_points(Emitter* emitter, Nodes declarations) {
         if (decl->tag != Function_TAG) continue;
         SpvId fn_id = find_reserved_id(emitter, decl);
 
-        const Node* entry_point = lookup_annotation(decl, "EntryPoint");
+        const Node* entry_point = lookup_known_annotation(decl, KnownAnnotationEntryPoint);
         if (entry_point) {
             const char* execution_model_name = get_string_literal(emitter->arena, get_annotation_value(entry_point));
             SpvExecutionModel execution_model = emit_exec_model(execution_model_from_string(execution_model_name));
@@ -441,7 +442,7 @@ static void emit_entry_points(Emitter* emitter, Nodes declarations) {
             spvb_entry_point(emitter->file_builder, execution_model, fn_id, decl->payload.fun.name, interface_size, interface_arr);
             emitter->num_entry_pts++;
 
-            const Node* workgroup_size = lookup_annotation(decl, "WorkgroupSize");
+            const Node* workgroup_size = lookup_known_annotation(decl, KnownAnnotationWorkgroupSize);
             if (execution_model == SpvExecutionModelGLCompute)
                 assert(workgroup_size);
             if (workgroup_size) {
@@ -474,9 +475,6 @@ SpvId get_extended_instruction_set(Emitter* emitter, const char* name) {
     return new;
 }
 
-KeyHash hash_node(Node**);
-bool compare_node(Node**, Node**);
-
 KeyHash hash_string(const char** string);
 bool compare_string(const char** a, const char** b);
 
@@ -485,14 +483,20 @@ static Module* run_backend_specific_passes(CompilerConfig* config, Module* mod)
     ArenaConfig aconfig = old_arena->config;
     Module* old_mod = mod;
     IrArena* tmp_arena = NULL;
+    IrArena* spare_arena = NULL;
+    uint64_t pass_start;
 
     RUN_PASS(lower_entrypoint_args)
     RUN_PASS(spirv_map_entrypoint_args)
 
+    if (spare_arena)
+        destroy_ir_arena(spare_arena);
+
     return mod;
 }
 
 void emit_spirv(CompilerConfig* config, Module* mod, size_t* output_size, char** output, Module** new_mod) {
+    trace_begin("emit_spirv");
     IrArena* initial_arena = get_module_arena(mod);
     mod = run_backend_specific_passes(config, mod);
     IrArena* arena = get_module_arena(mod);
@@ -508,8 +512,8 @@ void emit_spirv(CompilerConfig* config, Module* mod, size_t* output_size, char**
         .arena = arena,
         .configuration = config,
         .file_builder = file_builder,
-        .node_ids = new_dict(Node*, SpvId, (HashFn) hash_node, (CmpFn) compare_node),
-        .bb_builders = new_dict(Node*, BBBuilder, (HashFn) hash_node, (CmpFn) compare_node),
+        .node_ids = new_ptr_dict(Node*, SpvId),
+        .bb_builders = new_ptr_dict(Node*, BBBuilder),
         .num_entry_pts = 0,
     };
 
@@ -558,4 +562,5 @@ void emit_spirv(CompilerConfig* config, Module* mod, size_t* output_size, char**
         *new_mod = mod;
     else if (initial_arena != arena)
         destroy_ir_arena(arena);
+    trace_end();
 }
@@ -4,6 +4,7 @@
 
 #include "list.h"
 #include "dict.h"
+#include "id_table.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -20,9 +21,32 @@ static bool compare_strings(Strings* a, Strings* b);
 KeyHash hash_string(const char** string);
 bool compare_string(const char** a, const char** b);
 
+/// What string_set holds: the interned bytes along with their length and hash, so probing never has to strlen or rehash them
+typedef struct {
+    const char* str;
+    size_t len;
+    KeyHash hash;
+} InternedString;
+
+static KeyHash hash_interned_string(InternedString* string);
+static bool compare_interned_strings(InternedString* a, InternedString* b);
+
 KeyHash hash_node(const Node**);
 bool compare_node(const Node** a, const Node** b);
 
+/// Canonical storage for a two-element list, chained with the other pairs starting with the same node
+typedef struct SmallNodes_ SmallNodes;
+struct SmallNodes_ {
+    const Node* nodes[2];
+    SmallNodes* next;
+};
+
+static void intern_known_annotation_names(IrArena* arena) {
+#define X(name) arena->known_annotation_names[KnownAnnotation##name] = string(arena, #name);
+    KNOWN_ANNOTATIONS(X)
+#undef X
+}
+
 IrArena* new_ir_arena(ArenaConfig config) {
     IrArena* arena = malloc(sizeof(IrArena));
     *arena = (IrArena) {
@@ -32,13 +56,19 @@ IrArena* new_ir_arena(ArenaConfig config) {
         .next_free_id = 0,
 
         .modules = new_list(Module*),
+        .nodes_by_id = new_list(const Node*),
 
         .node_set = new_set(const Node*, (HashFn) hash_node, (CmpFn) compare_node),
-        .string_set = new_set(const char*, (HashFn) hash_string, (CmpFn) compare_string),
+        .string_set = new_set(InternedString, (HashFn) hash_interned_string, (CmpFn) compare_interned_strings),
 
         .nodes_set   = new_set(Nodes, (HashFn) hash_nodes, (CmpFn) compare_nodes),
         .strings_set = new_set(Strings, (HashFn) hash_strings, (CmpFn) compare_strings),
+
+        .singletons = new_id_table(const Node**),
+        .pairs = new_id_table(SmallNodes*),
+        .singleton_strings = new_ptr_dict(String, String*),
     };
+    intern_known_annotation_names(arena);
     return arena;
 }
 
@@ -48,6 +78,12 @@ void destroy_ir_arena(IrArena* arena) {
     }
 
     destroy_list(arena->modules);
+    destroy_list(arena->nodes_by_id);
+    if (arena->mem_layouts)
+        destroy_id_table(arena->mem_layouts);
+    destroy_dict(arena->singleton_strings);
+    destroy_id_table(arena->pairs);
+    destroy_id_table(arena->singletons);
     destroy_dict(arena->strings_set);
     destroy_dict(arena->string_set);
     destroy_dict(arena->nodes_set);
@@ -56,45 +92,161 @@ void destroy_ir_arena(IrArena* arena) {
     free(arena);
 }
 
+IrArena* reuse_ir_arena(IrArena* retired, ArenaConfig config, const IrArena* size_hint) {
+    IrArena* arena = retired;
+    if (arena) {
+        for (size_t i = 0; i < entries_count_list(arena->modules); i++) {
+            destroy_module(read_list(Module*, arena->modules)[i]);
+        }
+        clear_list(arena->modules);
+        clear_list(arena->nodes_by_id);
+        clear_dict(arena->node_set);
+        clear_dict(arena->string_set);
+        clear_dict(arena->nodes_set);
+        clear_dict(arena->strings_set);
+        clear_id_table(arena->singletons);
+        clear_id_table(arena->pairs);
+        clear_dict(arena->singleton_strings);
+        if (arena->mem_layouts)
+            clear_id_table(arena->mem_layouts);
+        arena_reset(arena->arena);
+        arena->config = config;
+        arena->next_free_id = 0;
+        intern_known_annotation_names(arena);
+    } else {
+        arena = new_ir_arena(config);
+    }
+
+    if (size_hint) {
+        reserve_dict(arena->node_set, entries_count_dict(size_hint->node_set));
+        reserve_dict(arena->string_set, entries_count_dict(size_hint->string_set));
+        reserve_dict(arena->nodes_set, entries_count_dict(size_hint->nodes_set));
+        reserve_dict(arena->strings_set, entries_count_dict(size_hint->strings_set));
+    }
+    return arena;
+}
+
+void assign_node_id(IrArena* arena, Node* node) {
+    node->id = (NodeId) entries_count_list(arena->nodes_by_id);
+    append_list(const Node*, arena->nodes_by_id, node);
+}
+
+const Node* get_node_by_id(const IrArena* arena, NodeId id) {
+    assert(id < entries_count_list(arena->nodes_by_id));
+    return read_list(const Node*, arena->nodes_by_id)[id];
+}
+
 VarId fresh_id(IrArena* arena) {
-    return arena->next_free_id++;
+    lock_ir_arena(arena);
+    VarId id = arena->next_free_id++;
+    unlock_ir_arena(arena);
+    return id;
+}
+
+/// Most lists are this short (params, operands, annotations...), these get looked up by the id of their first node
+/// rather than by hashing the whole array. The arena needs to be locked.
+static const Node** small_nodes(IrArena* arena, size_t count, const Node* in_nodes[]) {
+    NodeId key = in_nodes[0]->id;
+    if (count == 1) {
+        const Node*** found = find_value_id_table(const Node**, arena->singletons, key);
+        if (found)
+            return *found;
+        const Node** array = arena_alloc_uninit(arena->arena, sizeof(const Node*));
+        array[0] = in_nodes[0];
+        insert_id_table(const Node**, arena->singletons, key, array);
+        return array;
+    }
+
+    assert(count == 2);
+    SmallNodes** found = find_value_id_table(SmallNodes*, arena->pairs, key);
+    SmallNodes* head = found ? *found : NULL;
+    for (SmallNodes* pair = head; pair; pair = pair->next) {
+        if (pair->nodes[1] == in_nodes[1])
+            return pair->nodes;
+    }
+    SmallNodes* pair = arena_alloc_uninit(arena->arena, sizeof(SmallNodes));
+    *pair = (SmallNodes) {
+        .nodes = { in_nodes[0], in_nodes[1] },
+        .next = head,
+    };
+    if (found)
+        *found = pair;
+    else
+        insert_id_table(SmallNodes*, arena->pairs, key, pair);
+    return pair->nodes;
 }
 
 Nodes nodes(IrArena* arena, size_t count, const Node* in_nodes[]) {
+    if (count == 0)
+        return (Nodes) { .count = 0, .nodes = NULL };
+
     Nodes tmp = {
         .count = count,
         .nodes = in_nodes
     };
+    lock_ir_arena(arena);
+    // foreign or missing nodes have no id we can use, those lists go through the generic path
+    if (count <= 2 && in_nodes[0] && in_nodes[0]->arena == arena) {
+        tmp.nodes = small_nodes(arena, count, in_nodes);
+        unlock_ir_arena(arena);
+        return tmp;
+    }
+
     const Nodes* found = find_key_dict(Nodes, arena->nodes_set, tmp);
-    if (found)
-        return *found;
+    if (found) {
+        Nodes existing = *found;
+        unlock_ir_arena(arena);
+        return existing;
+    }
 
     Nodes nodes;
     nodes.count = count;
-    nodes.nodes = arena_alloc(arena->arena, sizeof(Node*) * count);
+    nodes.nodes = arena_alloc_uninit(arena->arena, sizeof(Node*) * count);
     for (size_t i = 0; i < count; i++)
         nodes.nodes[i] = in_nodes[i];
 
     insert_set_get_result(Nodes, arena->nodes_set, nodes);
+    unlock_ir_arena(arena);
     return nodes;
 }
 
 Strings strings(IrArena* arena, size_t count, const char* in_strs[])  {
+    if (count == 0)
+        return (Strings) { .count = 0, .strings = NULL };
+
     Strings tmp = {
         .count = count,
         .strings = in_strs,
     };
+    lock_ir_arena(arena);
+    if (count == 1) {
+        String** found = find_value_dict(String, String*, arena->singleton_strings, in_strs[0]);
+        if (found) {
+            tmp.strings = *found;
+        } else {
+            tmp.strings = arena_alloc_uninit(arena->arena, sizeof(String));
+            tmp.strings[0] = in_strs[0];
+            insert_dict(String, String*, arena->singleton_strings, in_strs[0], tmp.strings);
+        }
+        unlock_ir_arena(arena);
+        return tmp;
+    }
+
     const Strings* found = find_key_dict(Strings, arena->strings_set, tmp);
-    if (found)
-        return *found;
+    if (found) {
+        Strings existing = *found;
+        unlock_ir_arena(arena);
+        return existing;
+    }
 
     Strings strings;
     strings.count = count;
-    strings.strings = arena_alloc(arena->arena, sizeof(const char*) * count);
+    strings.strings = arena_alloc_uninit(arena->arena, sizeof(const char*) * count);
     for (size_t i = 0; i < count; i++)
         strings.strings[i] = in_strs[i];
 
     insert_set_get_result(Strings, arena->strings_set, strings);
+    unlock_ir_arena(arena);
     return strings;
 }
 
@@ -109,6 +261,40 @@ const Node* first(Nodes nodes) {
     return nodes.nodes[0];
 }
 
+struct NodesBuilder_ {
+    IrArena* arena;
+    struct List* list;
+};
+
+NodesBuilder* begin_nodes(IrArena* arena) {
+    NodesBuilder* builder = malloc(sizeof(NodesBuilder));
+    *builder = (NodesBuilder) {
+        .arena = arena,
+        .list = new_list(const Node*),
+    };
+    return builder;
+}
+
+void append_to_nodes(NodesBuilder* builder, const Node* node) {
+    append_list(const Node*, builder->list, node);
+}
+
+void concat_to_nodes(NodesBuilder* builder, Nodes nodes) {
+    for (size_t i = 0; i < nodes.count; i++)
+        append_list(const Node*, builder->list, nodes.nodes[i]);
+}
+
+Nodes finish_nodes(NodesBuilder* builder) {
+    Nodes result = list_to_nodes(builder->arena, builder->list);
+    cancel_nodes(builder);
+    return result;
+}
+
+void cancel_nodes(NodesBuilder* builder) {
+    destroy_list(builder->list);
+    free(builder);
+}
+
 Nodes append_nodes(IrArena* arena, Nodes old, const Node* new) {
     LARRAY(const Node*, tmp, old.count + 1);
     for (size_t i = 0; i < old.count; i++)
@@ -128,27 +314,37 @@ Nodes concat_nodes(IrArena* arena, Nodes a, Nodes b) {
     return nodes(arena, j, tmp);
 }
 
-/// takes care of structural sharing
-static const char* string_impl(IrArena* arena, size_t size, const char* zero_terminated) {
-    const char* ptr = zero_terminated;
-    const char** found = find_key_dict(const char*, arena->string_set, ptr);
-    if (found)
-        return *found;
+static InternedString make_interned_string(const char* str, size_t len) {
+    return (InternedString) {
+        .str = str,
+        .len = len,
+        .hash = hash_murmur(str, len),
+    };
+}
 
-    char* new_str = (char*) arena_alloc(arena->arena, strlen(zero_terminated) + 1);
-    strncpy(new_str, zero_terminated, size);
+/// takes care of structural sharing, `start` does not need to be zero-terminated
+static const char* string_impl(IrArena* arena, size_t size, const char* start) {
+    InternedString key = make_interned_string(start, size);
+    lock_ir_arena(arena);
+    const InternedString* found = find_key_dict(InternedString, arena->string_set, key);
+    if (found) {
+        const char* existing = found->str;
+        unlock_ir_arena(arena);
+        return existing;
+    }
+
+    char* new_str = (char*) arena_alloc_uninit(arena->arena, size + 1);
+    memcpy(new_str, start, size);
     new_str[size] = '\0';
+    key.str = new_str;
 
-    insert_set_get_result(const char*, arena->string_set, new_str);
+    insert_set_get_result(InternedString, arena->string_set, key);
+    unlock_ir_arena(arena);
     return new_str;
 }
 
 const char* string_sized(IrArena* arena, size_t size, const char* str) {
-    LARRAY(char, new_str, size + 1);
-
-    strncpy(new_str, str, size);
-    new_str[size] = '\0';
-    assert(strlen(new_str) == size);
+    assert(memchr(str, '\0', size) == NULL);
     return string_impl(arena, size, str);
 }
 
@@ -166,37 +362,47 @@ Strings import_strings(IrArena* dst_arena, Strings old_strings) {
 }
 
 enum {
-    ThreadLocalStaticBufferSize = 256
+    FormatStackBufferSize = 256
 };
 
-char static_buffer[ThreadLocalStaticBufferSize];
+/// Formats a string we already know the length of directly into the arena, and takes it back if it turns out to be interned already
+static const char* format_string_into_arena(IrArena* arena, size_t len, const char* str, va_list args) {
+    lock_ir_arena(arena);
+    ArenaCheckpoint checkpoint = arena_checkpoint(arena->arena);
+    char* new_str = (char*) arena_alloc_uninit(arena->arena, len + 1);
+    vsnprintf(new_str, len + 1, str, args);
+
+    InternedString key = make_interned_string(new_str, len);
+    const InternedString* found = find_key_dict(InternedString, arena->string_set, key);
+    if (found) {
+        const char* existing = found->str;
+        arena_rewind(arena->arena, checkpoint);
+        unlock_ir_arena(arena);
+        return existing;
+    }
+
+    insert_set_get_result(InternedString, arena->string_set, key);
+    unlock_ir_arena(arena);
+    return new_str;
+}
 
 String format_string(IrArena* arena, const char* str, ...) {
-    size_t buffer_size = ThreadLocalStaticBufferSize;
-    int len;
-    char* tmp;
-    while (true) {
-        if (buffer_size == ThreadLocalStaticBufferSize) {
-            tmp = static_buffer;
-        } else {
-            tmp = malloc(buffer_size);
-        }
-        va_list args;
-        va_start(args, str);
-        len = vsnprintf(tmp, buffer_size, str, args);
-        va_end(args);
-        if (len < 0 || len >= (int) buffer_size - 1) {
-            buffer_size *= 2;
-            if (tmp != static_buffer)
-                free(tmp);
-            continue;
-        } else {
-            const char* interned = string_impl(arena, len, tmp);
-            if (tmp != static_buffer)
-                free(tmp);
-            return interned;
-        }
-    }
+    // the common case fits on the stack, so this stays reentrant and only copies strings we have not seen yet
+    char stack_buffer[FormatStackBufferSize];
+    va_list args, args_copy;
+    va_start(args, str);
+    va_copy(args_copy, args);
+    int len = vsnprintf(stack_buffer, FormatStackBufferSize, str, args);
+    va_end(args);
+    assert(len >= 0);
+
+    const char* interned;
+    if (len < FormatStackBufferSize)
+        interned = string_impl(arena, len, stack_buffer);
+    else
+        interned = format_string_into_arena(arena, len, str, args_copy);
+    va_end(args_copy);
+    return interned;
 }
 
 const char* unique_name(IrArena* arena, const char* str) {
@@ -227,7 +433,15 @@ KeyHash hash_string(const char** string) {
 }
 
 bool compare_string(const char** a, const char** b) {
-    return strlen(*a) == strlen(*b) && strcmp(*a, *b) == 0;
+    return strcmp(*a, *b) == 0;
+}
+
+KeyHash hash_interned_string(InternedString* string) {
+    return string->hash;
+}
+
+bool compare_interned_strings(InternedString* a, InternedString* b) {
+    return a->hash == b->hash && a->len == b->len && memcmp(a->str, b->str, a->len) == 0;
 }
 
 Nodes list_to_nodes(IrArena* arena, struct List* list) {
@@ -4,6 +4,7 @@
 #include "shady/ir.h"
 
 #include "arena.h"
+#include "portability.h"
 
 #include "stdlib.h"
 #include "stdio.h"
@@ -15,21 +16,54 @@ typedef struct IrArena_ {
     VarId next_free_id;
     struct List* modules;
 
+    /// every node interned in this arena, indexed by its NodeId
+    struct List* nodes_by_id;
+
     struct Dict* node_set;
     struct Dict* string_set;
 
     struct Dict* nodes_set;
     struct Dict* strings_set;
+
+    /// Lists of one or two nodes are interned here instead, keyed on the id of their first element, see small_nodes
+    struct IdTable* singletons;
+    struct IdTable* pairs;
+    struct Dict* singleton_strings;
+
+    /// Names of the KNOWN_ANNOTATIONS, interned in this arena
+    String known_annotation_names[KnownAnnotationsCount];
+
+    /// Memory layouts of the types in this arena, by NodeId. Created on first use, see transform/memory_layout.c
+    struct IdTable* mem_layouts;
+
+    /// Only set while several threads intern into this arena at once, see rewrite_module_parallel
+    Mutex* lock;
 } IrArena_;
 
+static inline void lock_ir_arena(IrArena* arena) {
+    if (arena->lock)
+        lock_mutex(arena->lock);
+}
+
+static inline void unlock_ir_arena(IrArena* arena) {
+    if (arena->lock)
+        unlock_mutex(arena->lock);
+}
+
 struct Module_ {
     IrArena* arena;
     String name;
     struct List* decls;
+    /// decl name -> decl, so looking a declaration up does not scan the whole module
+    struct Dict* decls_by_name;
     bool sealed;
+    /// see analysis/cache.h
+    struct AnalysisCache_* analyses;
 };
 
 void register_decl_module(Module*, Node*);
+/// Replaces the list of declarations with `decls`, the ones left out are dropped from the module
+void set_module_declarations(Module*, size_t count, const Node** decls);
 void destroy_module(Module* m);
 
 struct BodyBuilder_ {
@@ -38,7 +72,19 @@ struct BodyBuilder_ {
     struct List* stack;
 };
 
+/// The header plus the payload for that tag, the rest of the union is never allocated so nodes may not be copied around whole
+static inline size_t node_alloc_size(NodeTag tag) {
+    return offsetof(Node, payload) + node_payload_size[tag];
+}
+
 VarId fresh_id(IrArena*);
+const Node* get_node_by_id(const IrArena*, NodeId);
+/// Hands out the next NodeId and records the node under it, the arena needs to be locked
+void assign_node_id(IrArena*, Node*);
+
+/// Lambdas are hash-consed on their body too, so one the rewriter fills in later is only interned once it's finished
+Node* deferred_lambda(Module*, Nodes params);
+void finish_deferred_lambda(Node* lambda, const Node* body);
 
 struct List;
 Nodes list_to_nodes(IrArena*, struct List*);
@@ -1,16 +1,25 @@
 #include "ir_private.h"
+#include "analysis/cache.h"
 
 #include "list.h"
+#include "dict.h"
+#include "id_table.h"
+#include "log.h"
 #include "portability.h"
 
 #include <string.h>
 
+KeyHash hash_string(const char** string);
+bool compare_string(const char** a, const char** b);
+
 Module* new_module(IrArena* arena, String name) {
     Module* m = arena_alloc(arena->arena, sizeof(Module));
     *m = (Module) {
         .arena = arena,
         .name = string(arena, name),
         .decls = new_list(Node*),
+        .decls_by_name = new_dict(String, Node*, (HashFn) hash_string, (CmpFn) compare_string),
+        .analyses = new_analysis_cache(),
     };
     append_list(Module*, arena->modules, m);
     return m;
@@ -30,16 +39,41 @@ Nodes get_module_declarations(const Module* m) {
     return nodes(get_module_arena(m), count, start);
 }
 
+Node* get_declaration(const Module* m, String name) {
+    Node** found = find_value_dict(String, Node*, m->decls_by_name, name);
+    return found ? *found : NULL;
+}
+
 void register_decl_module(Module* mod, Node* node) {
     assert(is_declaration(node));
-    Nodes existing_decls = get_module_declarations(mod);
-    for (size_t i = 0; i < existing_decls.count; i++) {
-        if (strcmp(get_decl_name(existing_decls.nodes[i]), get_decl_name(node)) == 0)
-            assert(false);
-    }
+    String name = get_decl_name(node);
+    if (!insert_dict_and_get_result(String, Node*, mod->decls_by_name, name, node))
+        error("module '%s' already has a declaration named '%s'", mod->name, name);
     append_list(Node*, mod->decls, node);
 }
 
+void set_module_declarations(Module* mod, size_t count, const Node** decls) {
+    struct IdTable* kept = new_id_set();
+    for (size_t i = 0; i < count; i++)
+        insert_id_set(kept, decls[i]->id);
+    size_t old_count = entries_count_list(mod->decls);
+    Node** old_decls = read_list(Node*, mod->decls);
+    for (size_t i = 0; i < old_count; i++) {
+        if (contains_id_table(kept, old_decls[i]->id)) continue;
+        String name = get_decl_name(old_decls[i]);
+        remove_dict(String, mod->decls_by_name, name);
+    }
+    destroy_id_table(kept);
+
+    clear_list(mod->decls);
+    for (size_t i = 0; i < count; i++) {
+        Node* decl = (Node*) decls[i];
+        append_list(Node*, mod->decls, decl);
+    }
+}
+
 void destroy_module(Module* m) {
+    destroy_analysis_cache(m->analyses);
+    destroy_dict(m->decls_by_name);
     destroy_list(m->decls);
 }
@@ -83,6 +83,17 @@ NODES(NODE_HAS_PAYLOAD)
 #undef NODE_HAS_PAYLOAD
 };
 
+const size_t node_payload_size[] = {
+    0,
+#define NODE_PAYLOAD_SIZE_1(StructName) sizeof(StructName),
+#define NODE_PAYLOAD_SIZE_0(StructName) 0,
+#define NODE_PAYLOAD_SIZE(_, _2, has_payload, StructName, _5) NODE_PAYLOAD_SIZE_##has_payload(StructName)
+NODES(NODE_PAYLOAD_SIZE)
+#undef NODE_PAYLOAD_SIZE
+#undef NODE_PAYLOAD_SIZE_0
+#undef NODE_PAYLOAD_SIZE_1
+};
+
 String get_decl_name(const Node* node) {
     switch (node->tag) {
         case Constant_TAG: return node->payload.constant.name;
@@ -198,8 +209,7 @@ const Node* get_let_tail(const Node* let) {
     }
 }
 
-KeyHash hash_node(Node** pnode) {
-    const Node* node = *pnode;
+KeyHash hash_node_contents(const Node* node) {
     KeyHash combined;
 
     if (is_nominal(node)) {
@@ -222,7 +232,7 @@ KeyHash hash_node(Node** pnode) {
             #define HASH_NODE_FIELDS_0(StructName, short_name)
             #define HASH_NODE_FIELDS(autogen_ctor, has_type_check_fn, has_payload, StructName, short_name) HASH_NODE_FIELDS_##has_payload(StructName, short_name)
             NODES(HASH_NODE_FIELDS)
-            default: payload_hash = hash_murmur(&node->payload, sizeof(node->payload)); break;
+            default: payload_hash = hash_murmur(&node->payload, node_payload_size[node->tag]); break;
         }
     }
     combined = tag_hash ^ payload_hash;
@@ -231,6 +241,10 @@ KeyHash hash_node(Node** pnode) {
     return combined;
 }
 
+KeyHash hash_node(Node** pnode) {
+    return (*pnode)->hash;
+}
+
 bool compare_node(Node** pa, Node** pb) {
     if ((*pa)->tag != (*pb)->tag) return false;
     if (is_nominal((*pa)))
@@ -252,7 +266,7 @@ bool compare_node(Node** pa, Node** pb) {
             #define CMP_NODE_FIELDS_0(StructName, short_name)
             #define CMP_NODE_FIELDS(autogen_ctor, has_type_check_fn, has_payload, StructName, short_name) CMP_NODE_FIELDS_##has_payload(StructName, short_name)
             NODES(CMP_NODE_FIELDS)
-            default: return memcmp(&a->payload, &b->payload, sizeof(a->payload)) == 0;
+            default: return memcmp(&a->payload, &b->payload, node_payload_size[a->tag]) == 0;
         }
         return eq;
     } else return true;
@@ -563,12 +563,12 @@ static const Node* accept_primop(ctxparams) {
     }
     next_token(tokenizer);
 
-    Nodes ty_args = nodes(arena, 0, NULL);
+    NodesBuilder* ty_args = begin_nodes(arena);
     if (accept_token(ctx, lsbracket_tok)) {
         while (true) {
             const Type* t = accept_unqualified_type(ctx);
             expect(t);
-            ty_args = append_nodes(arena, ty_args, t);
+            append_to_nodes(ty_args, t);
             if (accept_token(ctx, comma_tok))
                 continue;
             if (accept_token(ctx, rsbracket_tok))
@@ -578,7 +578,7 @@ static const Node* accept_primop(ctxparams) {
 
     return prim_op(arena, (PrimOp) {
         .op = op,
-        .type_arguments = ty_args,
+        .type_arguments = finish_nodes(ty_args),
         .operands = expect_operands(ctx)
     });
 }
@@ -23,29 +23,17 @@ const char* token_tags[] = {
 
 #undef PRIMOP
 
-static size_t token_strings_size[LIST_END_tok];
-static bool constants_initialized = false;
-
-static void init_tokenizer_constants() {
-    for (int i = 0; i < LIST_END_tok; i++) {
-        token_strings_size[i] = token_strings[i] == NULL ? 0 : strlen(token_strings[i]);
-    }
-}
-
 typedef struct Tokenizer_ {
     const char* const source;
     const size_t source_size;
     
     size_t pos;
     Token current;
+    /// kept per tokenizer rather than in a lazily initialised global, so tokenizers can be used from several threads
+    size_t token_strings_size[LIST_END_tok];
 } Tokenizer;
 
 Tokenizer* new_tokenizer(const char* source) {
-    if (!constants_initialized) {
-        init_tokenizer_constants();
-        constants_initialized = true;
-    }
-
     Tokenizer* alloc = (Tokenizer*) malloc(sizeof(Tokenizer));
     Tokenizer tokenizer = (Tokenizer) {
         .source = source,
@@ -53,6 +41,8 @@ Tokenizer* new_tokenizer(const char* source) {
         .pos = 0
     };
     memcpy(alloc, &tokenizer, sizeof(Tokenizer));
+    for (int i = 0; i < LIST_END_tok; i++)
+        alloc->token_strings_size[i] = token_strings[i] == NULL ? 0 : strlen(token_strings[i]);
     next_token(alloc);
     return alloc;
 }
@@ -151,7 +141,7 @@ Token next_token(Tokenizer* tokenizer) {
     }
 
     for (int i = 0; i < LIST_END_tok; i++) {
-        size_t tok_size = token_strings_size[i];
+        size_t tok_size = tokenizer->token_strings_size[i];
         // if there is a match ...
         if (tok_size != 0 && in_bounds(tokenizer, tok_size) && strncmp(token_strings[i], slice, tok_size) == 0) {
             // if this is an identifier, we need the size to match exactly
@@ -40,30 +40,24 @@ static Resolved resolve_using_name(Context* ctx, const char* name) {
         }
     }
 
-    Nodes new_decls = get_module_declarations(ctx->rewriter.dst_module);
-    for (size_t i = 0; i < new_decls.count; i++) {
-        const Node* decl = new_decls.nodes[i];
-        if (strcmp(get_decl_name(decl), name) == 0) {
-            return (Resolved) {
-                .is_var = decl->tag == GlobalVariable_TAG,
-                .node = decl
-            };
-        }
+    const Node* decl = get_declaration(ctx->rewriter.dst_module, name);
+    if (decl) {
+        return (Resolved) {
+            .is_var = decl->tag == GlobalVariable_TAG,
+            .node = decl
+        };
     }
 
-    Nodes old_decls = get_module_declarations(ctx->rewriter.src_module);
-    for (size_t i = 0; i < old_decls.count; i++) {
-        const Node* old_decl = old_decls.nodes[i];
-        if (strcmp(get_decl_name(old_decl), name) == 0) {
-            Context top_ctx = *ctx;
-            top_ctx.current_function = NULL;
-            top_ctx.local_variables = NULL;
-            const Node* decl = rewrite_node(&top_ctx.rewriter, old_decl);
-            return (Resolved) {
-                .is_var = decl->tag == GlobalVariable_TAG,
-                .node = decl
-            };
-        }
+    const Node* old_decl = get_declaration(ctx->rewriter.src_module, name);
+    if (old_decl) {
+        Context top_ctx = *ctx;
+        top_ctx.current_function = NULL;
+        top_ctx.local_variables = NULL;
+        decl = rewrite_node(&top_ctx.rewriter, old_decl);
+        return (Resolved) {
+            .is_var = decl->tag == GlobalVariable_TAG,
+            .node = decl
+        };
     }
 
     error("could not resolve node %s", name)
@@ -29,6 +29,7 @@ void eliminate_constants(SHADY_UNUSED CompilerConfig* config, Module* src, Modul
     Context ctx = {
         .rewriter = create_rewriter(src, dst, (RewriteFn) process)
     };
+    ctx.rewriter.config.worklist = true;
 
     rewrite_module(&ctx.rewriter);
     destroy_rewriter(&ctx.rewriter);
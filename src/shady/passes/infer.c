@@ -74,29 +74,38 @@ static const Node* _infer_type(Context* ctx, const Type* type) {
     }
 }
 
+static Node* _infer_fn_header(Context* ctx, const Node* node) {
+    assert(node->tag == Function_TAG);
+    IrArena* dst_arena = ctx->rewriter.dst_arena;
+
+    LARRAY(const Node*, nparams, node->payload.fun.params.count);
+    for (size_t i = 0; i < node->payload.fun.params.count; i++) {
+        const Variable* old_param = &node->payload.fun.params.nodes[i]->payload.var;
+        const Type* imported_param_type = infer(ctx, old_param->type, NULL);
+        nparams[i] = var(dst_arena, imported_param_type, old_param->name);
+        register_processed(&ctx->rewriter, node->payload.fun.params.nodes[i], nparams[i]);
+    }
+
+    Nodes nret_types = annotate_all_types(dst_arena, infer_nodes(ctx, node->payload.fun.return_types), false);
+    Node* fun = function(ctx->rewriter.dst_module, nodes(dst_arena, node->payload.fun.params.count, nparams), string(dst_arena, node->payload.fun.name), infer_nodes(ctx, node->payload.fun.annotations), nret_types);
+    register_processed(&ctx->rewriter, node, fun);
+    return fun;
+}
+
+static const Node* _infer_fn_body(Context* ctx, const Node* node, SHADY_UNUSED Node* fun) {
+    return infer(ctx, node->payload.fun.body, NULL);
+}
+
 static const Node* _infer_decl(Context* ctx, const Node* node) {
     assert(is_declaration(node));
     const Node* already_done = search_processed(&ctx->rewriter, node);
     if (already_done)
         return already_done;
 
-    IrArena* dst_arena = ctx->rewriter.dst_arena;
     switch (is_declaration(node)) {
         case Function_TAG: {
-            Context body_context = *ctx;
-
-            LARRAY(const Node*, nparams, node->payload.fun.params.count);
-            for (size_t i = 0; i < node->payload.fun.params.count; i++) {
-                const Variable* old_param = &node->payload.fun.params.nodes[i]->payload.var;
-                const Type* imported_param_type = infer(ctx, old_param->type, NULL);
-                nparams[i] = var(body_context.rewriter.dst_arena, imported_param_type, old_param->name);
-                register_processed(&body_context.rewriter, node->payload.fun.params.nodes[i], nparams[i]);
-            }
-
-            Nodes nret_types = annotate_all_types(dst_arena, infer_nodes(ctx, node->payload.fun.return_types), false);
-            Node* fun = function(ctx->rewriter.dst_module, nodes(dst_arena, node->payload.fun.params.count, nparams), string(dst_arena, node->payload.fun.name), infer_nodes(ctx, node->payload.fun.annotations), nret_types);
-            register_processed(&ctx->rewriter, node, fun);
-            fun->payload.fun.body = infer(&body_context, node->payload.fun.body, NULL);
+            Node* fun = _infer_fn_header(ctx, node);
+            fun->payload.fun.body = _infer_fn_body(ctx, node, fun);
             return fun;
         }
         case Constant_TAG: {
@@ -773,10 +782,13 @@ static const Node* process(Context* src_ctx, const Node* node) {
     assert(false);
 }
 
-void infer_program(SHADY_UNUSED CompilerConfig* config, Module* src, Module* dst) {
+void infer_program(CompilerConfig* config, Module* src, Module* dst) {
     Context ctx = {
         .rewriter = create_rewriter(src, dst, (RewriteFn) process),
     };
-    rewrite_module(&ctx.rewriter);
+    if (config->pass_threads > 0)
+        rewrite_module_parallel(&ctx.rewriter, sizeof(ctx), (RewriteFn) _infer_fn_header, (RewriteBodyFn) _infer_fn_body, config->pass_threads);
+    else
+        rewrite_module(&ctx.rewriter);
     destroy_rewriter(&ctx.rewriter);
 }
@@ -26,20 +26,25 @@ static const Node* lower_callf_process(Context* ctx, const Node* old) {
 
     if (old->tag == Function_TAG) {
         Context ctx2 = *ctx;
-        ctx2.disable_lowering = lookup_annotation(old, "Leaf");
+        ctx2.disable_lowering = lookup_known_annotation(old, KnownAnnotationLeaf);
         ctx2.return_jp = NULL;
         Node* fun = NULL;
         if (!ctx2.disable_lowering) {
             Nodes oparams = get_abstraction_params(old);
-            Nodes nparams = recreate_variables(&ctx->rewriter, oparams);
-            register_processed_list(&ctx->rewriter, oparams, nparams);
+            NodesBuilder* nparams_builder = begin_nodes(dst_arena);
+            for (size_t i = 0; i < oparams.count; i++) {
+                const Node* nparam = recreate_variable(&ctx->rewriter, oparams.nodes[i]);
+                register_processed(&ctx->rewriter, oparams.nodes[i], nparam);
+                append_to_nodes(nparams_builder, nparam);
+            }
 
             // Supplement an additional parameter for the join point
             const Type* jp_type = join_point_type(dst_arena, (JoinPointType) {
                 .yield_types = strip_qualifiers(dst_arena, rewrite_nodes(&ctx->rewriter, old->payload.fun.return_types))
             });
             const Node* jp_variable = var(dst_arena, qualified_type_helper(jp_type, true), "return_jp");
-            nparams = append_nodes(dst_arena, nparams, jp_variable);
+            append_to_nodes(nparams_builder, jp_variable);
+            Nodes nparams = finish_nodes(nparams_builder);
             ctx2.return_jp = jp_variable;
 
             Nodes nannots = rewrite_nodes(&ctx->rewriter, old->payload.fun.annotations);
@@ -89,7 +94,10 @@ static const Node* lower_callf_process(Context* ctx, const Node* old) {
 
                 // Rewrite the callee and its arguments
                 const Node* ncallee = rewrite_node(&ctx->rewriter, ocallee);
-                Nodes nargs = rewrite_nodes(&ctx->rewriter, old_instruction->payload.indirect_call.args);
+                Nodes oargs = old_instruction->payload.indirect_call.args;
+                NodesBuilder* nargs_builder = begin_nodes(dst_arena);
+                for (size_t i = 0; i < oargs.count; i++)
+                    append_to_nodes(nargs_builder, rewrite_node(&ctx->rewriter, oargs.nodes[i]));
 
                 // Create the body of the control that receives the appropriately typed join point
                 const Type* jp_type = qualified_type(dst_arena, (QualifiedType) {
@@ -99,7 +107,8 @@ static const Node* lower_callf_process(Context* ctx, const Node* old) {
                 const Node* jp = var(dst_arena, jp_type, "fn_return_point");
 
                 // Add that join point as the last argument to the newly made function
-                nargs = append_nodes(dst_arena, nargs, jp);
+                append_to_nodes(nargs_builder, jp);
+                Nodes nargs = finish_nodes(nargs_builder);
 
                 // the body of the control is just an immediate tail-call
                 const Node* control_body = tail_call(dst_arena, (TailCall) {
@@ -7,8 +7,8 @@
 #include "../rewrite.h"
 
 #include "../transform/ir_gen_helpers.h"
+#include "../analysis/cache.h"
 #include "../analysis/scope.h"
-#include "../analysis/free_variables.h"
 
 #include "list.h"
 #include "dict.h"
@@ -16,12 +16,11 @@
 #include <assert.h>
 #include <string.h>
 
-KeyHash hash_node(Node**);
-bool compare_node(Node**, Node**);
-
 typedef struct Context_ {
     Rewriter rewriter;
     struct Dict* lifted;
+    /// pure instructions defining the variables of the function being lowered, see find_rematerializable_definitions
+    struct Dict* definitions;
     bool disable_lowering;
 } Context;
 
@@ -30,7 +29,10 @@ static const Node* process_node(Context* ctx, const Node* node);
 typedef struct {
     const Node* old_cont;
     const Node* lifted_fn;
+    /// the variables pushed before going to the lifted function, and popped back in it
     struct List* save_values;
+    /// live variables that are recomputed in the lifted function instead
+    struct List* remat_values;
 } LiftedCont;
 
 #pragma GCC diagnostic error "-Wswitch"
@@ -52,6 +54,115 @@ static void add_spill_instrs(Context* ctx, BodyBuilder* builder, struct List* sp
     }
 }
 
+static bool is_cheap_operand(const Node* node) {
+    switch (node->tag) {
+        case IntLiteral_TAG:
+        case FloatLiteral_TAG:
+        case UntypedNumber_TAG:
+        case True_TAG:
+        case False_TAG: return true;
+        default: return false;
+    }
+}
+
+/// Pure primops that yield a single value, and are cheaper to compute again than to save on the stack
+static bool is_rematerializable_op(Op op) {
+    switch (op) {
+#define REMAT_CASE(_, name) case name##_op:
+        BITSTUFF_PRIMOPS(REMAT_CASE)
+        CMP_PRIMOPS(REMAT_CASE)
+        SHIFT_PRIMOPS(REMAT_CASE)
+        MATH_PRIMOPS(REMAT_CASE)
+#undef REMAT_CASE
+        case quote_op:
+        case add_op:
+        case sub_op:
+        case mul_op:
+        case div_op:
+        case mod_op:
+        case neg_op:
+        case select_op:
+        case convert_op:
+        case reinterpret_op:
+        case extract_op: return true;
+        default: return false;
+    }
+}
+
+/// Maps the variables bound by let tails in a function to the instruction computing them, when it is one we would rather do again
+static struct Dict* find_rematerializable_definitions(const Node* fn) {
+    struct Dict* definitions = new_ptr_dict(const Node*, const Node*);
+    Scope* scope = get_scope(fn);
+    for (size_t i = 0; i < scope->size; i++) {
+        CFNode* cfnode = read_list(CFNode*, scope->contents)[i];
+        for (size_t j = 0; j < entries_count_list(cfnode->succ_edges); j++) {
+            CFEdge edge = read_list(CFEdge, cfnode->succ_edges)[j];
+            // mutable variables might not hold what the instruction computed anymore
+            const Node* let = get_abstraction_body(cfnode->node);
+            if (edge.type != LetTailEdge || let->tag != Let_TAG)
+                continue;
+            const Node* instruction = get_let_instruction(let);
+            Nodes params = get_abstraction_params(edge.dst->node);
+            if (instruction->tag != PrimOp_TAG || params.count != 1)
+                continue;
+            PrimOp prim_op = instruction->payload.prim_op;
+            if (!is_rematerializable_op(prim_op.op) || (prim_op.op == quote_op && prim_op.operands.count != 1))
+                continue;
+            insert_dict(const Node*, const Node*, definitions, params.nodes[0], instruction);
+        }
+    }
+    release_scope(scope);
+    return definitions;
+}
+
+static const Node* get_definition(Context* ctx, const Node* var) {
+    if (!ctx->definitions)
+        return NULL;
+    const Node** found = find_value_dict(const Node*, const Node*, ctx->definitions, var);
+    return found ? *found : NULL;
+}
+
+/// Splits the live variables between the ones we need to save and the ones we can compute again from literals and other live variables.
+/// Since the latter are available in the lifted function either way, the choice does not depend on what else gets rematerialized.
+static void sort_live_variables(Context* ctx, struct List* live, struct List* save_values, struct List* remat_values) {
+    size_t live_count = entries_count_list(live);
+    struct Dict* live_set = new_ptr_set(const Node*);
+    for (size_t i = 0; i < live_count; i++)
+        insert_set_get_result(const Node*, live_set, read_list(const Node*, live)[i]);
+    for (size_t i = 0; i < live_count; i++) {
+        const Node* var = read_list(const Node*, live)[i];
+        const Node* instruction = get_definition(ctx, var);
+        if (instruction) {
+            Nodes operands = instruction->payload.prim_op.operands;
+            for (size_t j = 0; j < operands.count; j++) {
+                const Node* operand = operands.nodes[j];
+                if (is_cheap_operand(operand))
+                    continue;
+                if (operand->tag == Variable_TAG && find_key_dict(const Node*, live_set, operand))
+                    continue;
+                instruction = NULL;
+                break;
+            }
+        }
+        append_list(const Node*, instruction ? remat_values : save_values, var);
+    }
+    destroy_dict(live_set);
+}
+
+static void rematerialize(Context* ctx, BodyBuilder* builder, struct Dict* remat_set, const Node* ovar) {
+    if (search_processed(&ctx->rewriter, ovar))
+        return;
+    const Node* oinstruction = get_definition(ctx, ovar);
+    // whatever this is computed from needs to be there first
+    Nodes operands = oinstruction->payload.prim_op.operands;
+    for (size_t i = 0; i < operands.count; i++) {
+        if (find_key_dict(const Node*, remat_set, operands.nodes[i]))
+            rematerialize(ctx, builder, remat_set, operands.nodes[i]);
+    }
+    const Node* ninstruction = rewrite_node(&ctx->rewriter, oinstruction);
+    register_processed(&ctx->rewriter, ovar, first(bind_instruction_named(builder, ninstruction, &ovar->payload.var.name)));
+}
+
 static LiftedCont* lambda_lift(Context* ctx, const Node* cont, String given_name) {
     assert(is_basic_block(cont) || is_anonymous_lambda(cont));
     LiftedCont** found = find_value_dict(const Node*, LiftedCont*, ctx->lifted, cont);
@@ -64,18 +175,27 @@ static LiftedCont* lambda_lift(Context* ctx, const Node* cont, String given_name
     IrArena* arena = ctx->rewriter.dst_arena;
 
     // Compute the live stuff we'll need
-    Scope* scope = new_scope(cont);
-    struct List* recover_context = compute_free_variables(scope);
+    struct List* free_variables = get_free_variables(cont);
+    struct List* recover_context = new_list(const Node*);
+    struct List* remat_values = new_list(const Node*);
+    sort_live_variables(ctx, free_variables, recover_context, remat_values);
+    release_free_variables(cont, free_variables);
     size_t recover_context_size = entries_count_list(recover_context);
-    destroy_scope(scope);
 
-    debugv_print("free (spilled) variables at '%s': ", name);
+    debugv_print("spilled variables at '%s': ", name);
     for (size_t i = 0; i < recover_context_size; i++) {
         const Node* item = read_list(const Node*, recover_context)[i];
         debugv_print("%s~%d", item->payload.var.name, item->payload.var.id);
         if (i + 1 < recover_context_size)
             debugv_print(", ");
     }
+    debugv_print(", rematerialized: ");
+    for (size_t i = 0; i < entries_count_list(remat_values); i++) {
+        const Node* item = read_list(const Node*, remat_values)[i];
+        debugv_print("%s~%d", item->payload.var.name, item->payload.var.id);
+        if (i + 1 < entries_count_list(remat_values))
+            debugv_print(", ");
+    }
     debugv_print("\n");
 
     // Create and register new parameters for the lifted continuation
@@ -89,6 +209,7 @@ static LiftedCont* lambda_lift(Context* ctx, const Node* cont, String given_name
     lifted_cont->old_cont = cont;
     lifted_cont->lifted_fn = new_fn;
     lifted_cont->save_values = recover_context;
+    lifted_cont->remat_values = remat_values;
     insert_dict(const Node*, LiftedCont*, ctx->lifted, cont, lifted_cont);
 
     Context lifting_ctx = *ctx;
@@ -114,6 +235,14 @@ static LiftedCont* lambda_lift(Context* ctx, const Node* cont, String given_name
         register_processed(&lifting_ctx.rewriter, ovar, recovered_value);
     }
 
+    // Then compute again what we did not save
+    struct Dict* remat_set = new_ptr_set(const Node*);
+    for (size_t i = 0; i < entries_count_list(remat_values); i++)
+        insert_set_get_result(const Node*, remat_set, read_list(const Node*, remat_values)[i]);
+    for (size_t i = 0; i < entries_count_list(remat_values); i++)
+        rematerialize(&lifting_ctx, builder, remat_set, read_list(const Node*, remat_values)[i]);
+    destroy_dict(remat_set);
+
     const Node* substituted = rewrite_node(&lifting_ctx.rewriter, obody);
     //destroy_dict(lifting_ctx.rewriter.processed);
     destroy_rewriter(&lifting_ctx.rewriter);
@@ -130,12 +259,9 @@ static const Node* process_node(Context* ctx, const Node* node) {
 
     // TODO: share this code
     if (is_declaration(node)) {
-        String name = get_decl_name(node);
-        Nodes decls = get_module_declarations(ctx->rewriter.dst_module);
-        for (size_t i = 0; i < decls.count; i++) {
-            if (strcmp(get_decl_name(decls.nodes[i]), name) == 0)
-                return decls.nodes[i];
-        }
+        const Node* existing = get_declaration(ctx->rewriter.dst_module, get_decl_name(node));
+        if (existing)
+            return existing;
     }
 
     IrArena* arena = ctx->rewriter.dst_arena;
@@ -143,6 +269,15 @@ static const Node* process_node(Context* ctx, const Node* node) {
     if (ctx->disable_lowering)
          return recreate_node_identity(&ctx->rewriter, node);
 
+    if (node->tag == Function_TAG) {
+        Node* fun = recreate_decl_header_identity(&ctx->rewriter, node);
+        Context sub_ctx = *ctx;
+        sub_ctx.definitions = find_rematerializable_definitions(node);
+        recreate_decl_body_identity(&sub_ctx.rewriter, node, fun);
+        destroy_dict(sub_ctx.definitions);
+        return fun;
+    }
+
     switch (node->tag) {
         // everywhere we might call a basic block, we insert appropriate spilling context
         case Jump_TAG: {
@@ -217,7 +352,7 @@ static const Node* process_node(Context* ctx, const Node* node) {
 void lower_continuations(SHADY_UNUSED CompilerConfig* config, Module* src, Module* dst) {
     Context ctx = {
         .rewriter = create_rewriter(src, dst, (RewriteFn) process_node),
-        .lifted = new_dict(const Node*, LiftedCont*, (HashFn) hash_node, (CmpFn) compare_node),
+        .lifted = new_ptr_dict(const Node*, LiftedCont*),
     };
 
     rewrite_module(&ctx.rewriter);
@@ -226,6 +361,7 @@ void lower_continuations(SHADY_UNUSED CompilerConfig* config, Module* src, Modul
     LiftedCont* lifted_cont;
     while (dict_iter(ctx.lifted, &iter, NULL, &lifted_cont)) {
         destroy_list(lifted_cont->save_values);
+        destroy_list(lifted_cont->remat_values);
         free(lifted_cont);
     }
     destroy_dict(ctx.lifted);
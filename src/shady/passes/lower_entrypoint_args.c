@@ -80,7 +80,7 @@ static const Node* process(Context* ctx, const Node* node) {
 
     switch (node->tag) {
         case Function_TAG:
-            if (lookup_annotation(node, "EntryPoint") && node->payload.fun.params.count > 0) {
+            if (lookup_known_annotation(node, KnownAnnotationEntryPoint) && node->payload.fun.params.count > 0) {
                 Node* new_entry_point = rewrite_entry_point_fun(ctx, node);
                 const Node* arg_struct = generate_arg_struct(&ctx->rewriter, node, new_entry_point);
                 new_entry_point->payload.fun.body = rewrite_body(ctx, node, arg_struct);
@@ -98,6 +98,7 @@ void lower_entrypoint_args(SHADY_UNUSED CompilerConfig* config, Module* src, Mod
         .rewriter = create_rewriter(src, dst, (RewriteFn) process),
         .config = config
     };
+    ctx.rewriter.config.worklist = true;
     rewrite_module(&ctx.rewriter);
     destroy_rewriter(&ctx.rewriter);
 }
@@ -182,6 +182,7 @@ void lower_generic_ptrs(CompilerConfig* config, Module* src, Module* dst) {
     Context ctx = {
         .rewriter = create_rewriter(src, dst, (RewriteFn) process)
     };
+    ctx.rewriter.config.worklist = true;
     rewrite_module(&ctx.rewriter);
     destroy_rewriter(&ctx.rewriter);
 }
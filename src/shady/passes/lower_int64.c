@@ -88,6 +88,7 @@ void lower_int(CompilerConfig* config, Module* src, Module* dst) {
         .rewriter = create_rewriter(src, dst, (RewriteFn) process),
         .config = config,
     };
+    ctx.rewriter.config.worklist = true;
     rewrite_module(&ctx.rewriter);
     destroy_rewriter(&ctx.rewriter);
 }
@@ -64,6 +64,7 @@ void lower_mask(SHADY_UNUSED CompilerConfig* config, Module* src, Module* dst) {
         .zero = int_literal(arena, (IntLiteral) { .width = mask_type->payload.int_type.width, .value = 0 }),
         .one = int_literal(arena, (IntLiteral) { .width = mask_type->payload.int_type.width, .value = 1 }),
     };
+    ctx.rewriter.config.worklist = true;
     rewrite_module(&ctx.rewriter);
     destroy_rewriter(&ctx.rewriter);
 }
@@ -330,9 +330,6 @@ static const Node* process_node(Context* ctx, const Node* old) {
     }
 }
 
-KeyHash hash_node(Node**);
-bool compare_node(Node**, Node**);
-
 /// Collects all global variables in a specific AS, and creates a record type for them.
 static void collect_globals_into_record_type(Context* ctx, Node* global_struct_t, AddressSpace as) {
     IrArena* a = ctx->rewriter.dst_arena;
@@ -419,6 +416,7 @@ void lower_physical_ptrs(CompilerConfig* config, Module* src, Module* dst) {
         .rewriter = create_rewriter(src, dst, (RewriteFn) process_node),
         .config = config,
     };
+    ctx.rewriter.config.worklist = true;
 
     construct_emulated_memory_array(&ctx, AsPrivatePhysical, AsPrivateLogical);
     construct_emulated_memory_array(&ctx, AsSubgroupPhysical, AsSubgroupLogical);
@@ -426,10 +424,10 @@ void lower_physical_ptrs(CompilerConfig* config, Module* src, Module* dst) {
 
     for (size_t i = 0; i < NumAddressSpaces; i++) {
         if (is_as_emulated(&ctx, i)) {
-            ctx.serialisation_varying[i] = new_dict(const Node*, Node*, (HashFn) hash_node, (CmpFn) compare_node);
-            ctx.deserialisation_varying[i] = new_dict(const Node*, Node*, (HashFn) hash_node, (CmpFn) compare_node);
-            ctx.serialisation_uniform[i] = new_dict(const Node*, Node*, (HashFn) hash_node, (CmpFn) compare_node);
-            ctx.deserialisation_uniform[i] = new_dict(const Node*, Node*, (HashFn) hash_node, (CmpFn) compare_node);
+            ctx.serialisation_varying[i] = new_ptr_dict(const Node*, Node*);
+            ctx.deserialisation_varying[i] = new_ptr_dict(const Node*, Node*);
+            ctx.serialisation_uniform[i] = new_ptr_dict(const Node*, Node*);
+            ctx.deserialisation_uniform[i] = new_ptr_dict(const Node*, Node*);
         }
     }
 
@@ -195,9 +195,6 @@ static const Node* process_node(Context* ctx, const Node* old) {
     }
 }
 
-KeyHash hash_node(Node**);
-bool compare_node(Node**, Node**);
-
 void lower_stack(SHADY_UNUSED CompilerConfig* config, Module* src, Module* dst) {
     IrArena* dst_arena = get_module_arena(dst);
 
@@ -230,10 +227,10 @@ void lower_stack(SHADY_UNUSED CompilerConfig* config, Module* src, Module* dst)
 
         .config = config,
 
-        .push_uniforms = new_dict(const Node*, Node*, (HashFn) hash_node, (CmpFn) compare_node),
-        .push = new_dict(const Node*, Node*, (HashFn) hash_node, (CmpFn) compare_node),
-        .pop_uniforms = new_dict(const Node*, Node*, (HashFn) hash_node, (CmpFn) compare_node),
-        .pop = new_dict(const Node*, Node*, (HashFn) hash_node, (CmpFn) compare_node),
+        .push_uniforms = new_ptr_dict(const Node*, Node*),
+        .push = new_ptr_dict(const Node*, Node*),
+        .pop_uniforms = new_ptr_dict(const Node*, Node*),
+        .pop = new_ptr_dict(const Node*, Node*),
 
         .stack = ref_decl(dst_arena, (RefDecl) { .decl = stack_decl }),
         .stack_pointer = ref_decl(dst_arena, (RefDecl) { .decl = stack_ptr_decl }),
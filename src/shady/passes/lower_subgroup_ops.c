@@ -109,6 +109,7 @@ void lower_subgroup_ops(SHADY_UNUSED CompilerConfig* config, Module* src, Module
         .rewriter = create_rewriter(src, dst, (RewriteFn) process),
         .config = config
     };
+    ctx.rewriter.config.worklist = true;
     rewrite_module(&ctx.rewriter);
     destroy_rewriter(&ctx.rewriter);
 }
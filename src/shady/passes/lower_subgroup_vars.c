@@ -47,6 +47,7 @@ void lower_subgroup_vars(SHADY_UNUSED CompilerConfig* config, Module* src, Modul
         .rewriter = create_rewriter(src, dst, (RewriteFn) process),
         .config = config
     };
+    ctx.rewriter.config.worklist = true;
     rewrite_module(&ctx.rewriter);
     destroy_rewriter(&ctx.rewriter);
 }
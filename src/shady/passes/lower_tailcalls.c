@@ -96,10 +96,10 @@ static const Node* process(Context* ctx, const Node* old) {
         case Function_TAG: {
             Context ctx2 = *ctx;
 
-            const Node* entry_point_annotation = lookup_annotation_list(old->payload.fun.annotations, "EntryPoint");
+            const Node* entry_point_annotation = lookup_known_annotation_list(old->payload.fun.annotations, KnownAnnotationEntryPoint);
 
             // Leave leaf-calls alone :)
-            ctx2.disable_lowering = lookup_annotation(old, "Leaf") || !old->payload.fun.body;
+            ctx2.disable_lowering = lookup_known_annotation(old, KnownAnnotationLeaf) || !old->payload.fun.body;
             if (ctx2.disable_lowering) {
                 Node* fun = recreate_decl_header_identity(&ctx2.rewriter, old);
                 if (old->payload.fun.body) {
@@ -275,7 +275,7 @@ void generate_top_level_dispatch_fn(Context* ctx) {
     for (size_t i = 0; i < old_decls.count; i++) {
         const Node* decl = old_decls.nodes[i];
         if (decl->tag == Function_TAG) {
-            if (lookup_annotation(decl, "Leaf"))
+            if (lookup_known_annotation(decl, KnownAnnotationLeaf))
                 continue;
 
             const Node* fn_lit = lower_fn_addr(ctx, decl);
@@ -336,11 +336,8 @@ void generate_top_level_dispatch_fn(Context* ctx) {
     }));
 }
 
-KeyHash hash_node(Node**);
-bool compare_node(Node**, Node**);
-
 void lower_tailcalls(SHADY_UNUSED CompilerConfig* config, Module* src, Module* dst) {
-    struct Dict* ptrs = new_dict(const Node*, FnPtr, (HashFn) hash_node, (CmpFn) compare_node);
+    struct Dict* ptrs = new_ptr_dict(const Node*, FnPtr);
     IrArena* dst_arena = get_module_arena(dst);
 
     Node* init_fn = function(dst, nodes(dst_arena, 0, NULL), "generated_init", singleton(annotation(dst_arena, (Annotation) { .name = "Generated" })), nodes(dst_arena, 0, NULL));
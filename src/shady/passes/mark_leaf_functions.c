@@ -1,12 +1,14 @@
 #include "passes.h"
 
 #include "dict.h"
+#include "id_table.h"
 #include "portability.h"
 #include "log.h"
 
 #include "../rewrite.h"
 
 #include "../analysis/callgraph.h"
+#include "../analysis/cache.h"
 
 typedef struct {
     Rewriter rewriter;
@@ -47,7 +49,7 @@ static bool is_leaf_fn(Context* ctx, CGNode* fn_node) {
 
     size_t iter = 0;
     CGNode* n;
-    while (dict_iter(fn_node->callees, &iter, &n, NULL)) {
+    while (id_table_iter(fn_node->callees, &iter, NULL, &n)) {
         if (!is_leaf_fn(ctx, n)) {
             info->is_leaf = false;
             info->done = true;
@@ -70,7 +72,7 @@ static const Node* process(Context* ctx, const Node* node) {
 
     switch (node->tag) {
         case Function_TAG: {
-            CGNode* fn_node = *find_value_dict(const Node*, CGNode*, ctx->graph->fn2cgn, node);
+            CGNode* fn_node = *find_value_id_table(CGNode*, ctx->graph->fn2cgn, node->id);
             Nodes annotations = rewrite_nodes(&ctx->rewriter, node->payload.fun.annotations);
             if (is_leaf_fn(ctx, fn_node)) {
                 // It's MaybeLeaf because beside the call graph, there might be some join point shenanigans going on
@@ -91,17 +93,15 @@ static const Node* process(Context* ctx, const Node* node) {
     }
 }
 
-KeyHash hash_node(Node**);
-bool compare_node(Node**, Node**);
-
 void mark_leaf_functions(SHADY_UNUSED CompilerConfig* config, Module* src, Module* dst) {
     Context ctx = {
         .rewriter = create_rewriter(src, dst, (RewriteFn) process),
-        .fns = new_dict(const Node*, FnInfo, (HashFn) hash_node, (CmpFn) compare_node),
-        .graph = new_callgraph(src)
+        .fns = new_ptr_dict(const Node*, FnInfo),
+        .graph = get_callgraph(src)
     };
+    ctx.rewriter.config.worklist = true;
     rewrite_module(&ctx.rewriter);
     destroy_dict(ctx.fns);
-    destroy_callgraph(ctx.graph);
+    release_callgraph(src, ctx.graph);
     destroy_rewriter(&ctx.rewriter);
 }
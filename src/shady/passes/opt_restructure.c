@@ -1,6 +1,6 @@
 #include "passes.h"
 
-#include "dict.h"
+#include "id_table.h"
 #include "list.h"
 #include "portability.h"
 #include "log.h"
@@ -97,8 +97,8 @@ static const Node* handle_bb_callsite(Context* ctx, BodyBuilder* bb, const Node*
         DFSStackEntry dfs_entry = { .parent = ctx->dfs_stack, .old = dst, .containing_control = ctx->control_stack };
         ctx2.dfs_stack = &dfs_entry;
         
-        struct Dict* tmp_processed = clone_dict(ctx->rewriter.map);
-        append_list(struct Dict*, ctx->tmp_alloc_stack, tmp_processed);
+        struct IdTable* tmp_processed = clone_id_table(ctx->rewriter.map);
+        append_list(struct IdTable*, ctx->tmp_alloc_stack, tmp_processed);
         ctx2.rewriter.map = tmp_processed;
         for (size_t i = 0; i < oargs.count; i++) {
             nparams[i] = var(arena, rewrite_node(&ctx->rewriter, oparams.nodes[i]->type), "arg");
@@ -115,7 +115,7 @@ static const Node* handle_bb_callsite(Context* ctx, BodyBuilder* bb, const Node*
         const Node* structured = structure(&ctx2, dst, let(arena, unit(arena), exit_ladder_trampoline));
         assert(is_terminator(structured));
         // forget we rewrote all that
-        destroy_dict(tmp_processed);
+        destroy_id_table(tmp_processed);
         pop_list_impl(ctx->tmp_alloc_stack);
 
         if (dfs_entry.loop_header) {
@@ -186,7 +186,7 @@ static const Node* structure(Context* ctx, const Node* abs, const Node* exit_lad
                     const Node* callee = old_instr->payload.indirect_call.callee;
                     if (callee->tag == FnAddr_TAG) {
                         const Node* fn = rewrite_node(&ctx->rewriter, callee->payload.fn_addr.fn);
-                        if (lookup_annotation(fn, "Leaf")) {
+                        if (lookup_known_annotation(fn, KnownAnnotationLeaf)) {
                             const Node* call = leaf_call(arena, (LeafCall) {
                                 .callee = fn,
                                 .args = rewrite_nodes(&ctx->rewriter, old_instr->payload.indirect_call.args)
@@ -321,12 +321,9 @@ static const Node* process(Context* ctx, const Node* node) {
     if (found) return found;
 
     if (is_declaration(node)) {
-        String name = get_decl_name(node);
-        Nodes decls = get_module_declarations(ctx->rewriter.dst_module);
-        for (size_t i = 0; i < decls.count; i++) {
-            if (strcmp(get_decl_name(decls.nodes[i]), name) == 0)
-                return decls.nodes[i];
-        }
+        const Node* existing = get_declaration(ctx->rewriter.dst_module, get_decl_name(node));
+        if (existing)
+            return existing;
     }
 
     if (node->tag == Function_TAG) {
@@ -337,9 +334,9 @@ static const Node* process(Context* ctx, const Node* node) {
         Context ctx2 = *ctx;
         ctx2.dfs_stack = NULL;
         ctx2.control_stack = NULL;
-        bool is_builtin = lookup_annotation(node, "Builtin");
+        bool is_builtin = lookup_known_annotation(node, KnownAnnotationBuiltin);
         bool is_leaf = false;
-        if (is_builtin || !node->payload.fun.body || !lookup_annotation(node, "MaybeLeaf") || setjmp(ctx2.bail)) {
+        if (is_builtin || !node->payload.fun.body || !lookup_known_annotation(node, KnownAnnotationMaybeLeaf) || setjmp(ctx2.bail)) {
             ctx2.lower = false;
             ctx2.rewriter.map = ctx->rewriter.map;
             if (node->payload.fun.body)
@@ -353,8 +350,8 @@ static const Node* process(Context* ctx, const Node* node) {
             bind_instruction(bb, prim_op(arena, (PrimOp) { .op = store_op, .operands = mk_nodes(arena, ptr, int32_literal(arena, 0)) }));
             ctx2.level_ptr = ptr;
             ctx2.fn = new;
-            struct Dict* tmp_processed = clone_dict(ctx->rewriter.map);
-            append_list(struct Dict*, ctx->tmp_alloc_stack, tmp_processed);
+            struct IdTable* tmp_processed = clone_id_table(ctx->rewriter.map);
+            append_list(struct IdTable*, ctx->tmp_alloc_stack, tmp_processed);
             ctx2.rewriter.map = tmp_processed;
             new->payload.fun.body = finish_body(bb, structure(&ctx2, node, unreachable(arena)));
             is_leaf = true;
@@ -365,8 +362,8 @@ static const Node* process(Context* ctx, const Node* node) {
 
         // if we did a longjmp, we might have orphaned a few of those
         while (alloc_stack_size_now < entries_count_list(ctx->tmp_alloc_stack)) {
-            struct Dict* orphan = pop_last_list(struct Dict*, ctx->tmp_alloc_stack);
-            destroy_dict(orphan);
+            struct IdTable* orphan = pop_last_list(struct IdTable*, ctx->tmp_alloc_stack);
+            destroy_id_table(orphan);
         }
 
         new->payload.fun.annotations = filter_out_annotation(arena, new->payload.fun.annotations, "MaybeLeaf");
@@ -376,7 +373,7 @@ static const Node* process(Context* ctx, const Node* node) {
         const Node* callee = node->payload.indirect_call.callee;
         if (callee->tag == FnAddr_TAG) {
             const Node* fn = rewrite_node(&ctx->rewriter, callee->payload.fn_addr.fn);
-            if (lookup_annotation(fn, "Leaf")) {
+            if (lookup_known_annotation(fn, KnownAnnotationLeaf)) {
                 const Node* call = leaf_call(arena, (LeafCall) {
                         .callee = fn,
                         .args = rewrite_nodes(&ctx->rewriter, node->payload.indirect_call.args)
@@ -401,7 +398,7 @@ void opt_restructurize(SHADY_UNUSED CompilerConfig* config, Module* src, Module*
     IrArena* arena = get_module_arena(dst);
     Context ctx = {
         .rewriter = create_rewriter(src, dst, (RewriteFn) process),
-        .tmp_alloc_stack = new_list(struct Dict*),
+        .tmp_alloc_stack = new_list(struct IdTable*),
     };
     rewrite_module(&ctx.rewriter);
     destroy_rewriter(&ctx.rewriter);
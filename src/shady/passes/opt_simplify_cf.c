@@ -1,6 +1,6 @@
 #include "passes.h"
 
-#include "dict.h"
+#include "id_table.h"
 #include "list.h"
 #include "portability.h"
 #include "log.h"
@@ -9,6 +9,7 @@
 
 #include "../analysis/scope.h"
 #include "../analysis/callgraph.h"
+#include "../analysis/cache.h"
 
 typedef struct {
     Rewriter rewriter;
@@ -28,8 +29,8 @@ static const Node* process(Context* ctx, const Node* node) {
 
     switch (node->tag) {
         case Function_TAG: {
-            CGNode* fn_node = *find_value_dict(const Node*, CGNode*, ctx->graph->fn2cgn, node);
-            if (entries_count_dict(fn_node->callers) == 1 && !fn_node->is_address_captured)
+            CGNode* fn_node = *find_value_id_table(CGNode*, ctx->graph->fn2cgn, node->id);
+            if (entries_count_id_table(fn_node->callers) == 1 && !fn_node->is_address_captured)
                 return NULL;
 
             Nodes annotations = rewrite_nodes(&ctx->rewriter, node->payload.fun.annotations);
@@ -39,11 +40,11 @@ static const Node* process(Context* ctx, const Node* node) {
             register_processed(&ctx->rewriter, node, new);
 
             Context fn_ctx = *ctx;
-            Scope* scope = new_scope(node);
+            Scope* scope = get_scope(node);
             fn_ctx.scope = scope;
             fn_ctx.fun = new;
             recreate_decl_body_identity(&fn_ctx.rewriter, node, new);
-            destroy_scope(scope);
+            release_scope(scope);
             return new;
         }
         case Jump_TAG: {
@@ -71,18 +72,18 @@ static const Node* process(Context* ctx, const Node* node) {
             const Node* dst = node->payload.tail_call.target;
             if (dst->tag == FnAddr_TAG) {
                 const Node* dst_fn = dst->payload.fn_addr.fn;
-                CGNode* fn_node = *find_value_dict(const Node*, CGNode*, ctx->graph->fn2cgn, dst_fn);
-                if (entries_count_dict(fn_node->callers) == 1 && !fn_node->is_address_captured) {
+                CGNode* fn_node = *find_value_id_table(CGNode*, ctx->graph->fn2cgn, dst_fn->id);
+                if (entries_count_id_table(fn_node->callers) == 1 && !fn_node->is_address_captured) {
                     debugv_print("Inlining call to %s\n", get_abstraction_name(dst_fn));
                     Nodes oparams = dst_fn->payload.fun.params;
                     Nodes nparams = recreate_variables(&ctx->rewriter, oparams);
                     Context inline_context = *ctx;
                     register_processed_list(&inline_context.rewriter, oparams, nparams);
 
-                    Scope* scope = new_scope(dst_fn);
+                    Scope* scope = get_scope(dst_fn);
                     inline_context.scope = scope;
                     const Node* nbody = rewrite_node(&inline_context.rewriter, dst_fn->payload.fun.body);
-                    destroy_scope(scope);
+                    release_scope(scope);
 
                     const Node* lam = lambda(ctx->rewriter.dst_module, nparams, nbody);
                     Nodes args = rewrite_nodes(&ctx->rewriter, node->payload.tail_call.args);
@@ -106,11 +107,11 @@ static const Node* process(Context* ctx, const Node* node) {
 void opt_simplify_cf(SHADY_UNUSED CompilerConfig* config, Module* src, Module* dst) {
     Context ctx = {
         .rewriter = create_rewriter(src, dst, (RewriteFn) process),
-        .graph = new_callgraph(src),
+        .graph = get_callgraph(src),
         .scope = NULL,
         .fun = NULL,
     };
     rewrite_module(&ctx.rewriter);
-    destroy_callgraph(ctx.graph);
+    release_callgraph(src, ctx.graph);
     destroy_rewriter(&ctx.rewriter);
 }
@@ -66,7 +66,7 @@ static const Node* process(Context* ctx, const Node* node) {
         case Function_TAG: {
             Node* fun = recreate_decl_header_identity(&ctx->rewriter, node);
             Context ctx2 = *ctx;
-            ctx2.disable_lowering = lookup_annotation_with_string_payload(node, "DisablePass", "setup_stack_frames");
+            ctx2.disable_lowering = lookup_known_annotation_with_string_payload(node, KnownAnnotationDisablePass, "setup_stack_frames");
 
             BodyBuilder* bb = begin_body(ctx->rewriter.dst_module);
             if (!ctx2.disable_lowering) {
@@ -76,6 +76,7 @@ static const Node* process(Context* ctx, const Node* node) {
                     .visitor = {
                         .visit_fn = (VisitFn) collect_allocas,
                         .visit_fn_scope_rpo = true,
+                        .worklist = true,
                     },
                     .context = &ctx2,
                     .builder = bb,
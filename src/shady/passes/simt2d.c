@@ -96,6 +96,7 @@ void simt2d(SHADY_UNUSED CompilerConfig* config, Module* src, Module* dst) {
         .width = config->subgroup_size,
         .mask = NULL,
     };
+    ctx.rewriter.config.worklist = true;
 
     rewrite_module(&ctx.rewriter);
     destroy_rewriter(&ctx.rewriter);
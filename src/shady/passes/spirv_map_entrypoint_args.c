@@ -37,7 +37,7 @@ static const Node* process(Context* ctx, const Node* node) {
 
     switch (node->tag) {
         case GlobalVariable_TAG:
-            if (lookup_annotation(node, "EntryPointArgs")) {
+            if (lookup_known_annotation(node, KnownAnnotationEntryPointArgs)) {
                 if (node->payload.global_variable.address_space != AsExternal)
                     error("EntryPointArgs address space must be extern");
 
@@ -67,6 +67,7 @@ void spirv_map_entrypoint_args(SHADY_UNUSED CompilerConfig* config, Module* src,
         .rewriter = create_rewriter(src, dst, (RewriteFn) process),
         .config = config
     };
+    ctx.rewriter.config.worklist = true;
     rewrite_module(&ctx.rewriter);
     destroy_rewriter(&ctx.rewriter);
 }
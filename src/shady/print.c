@@ -1,5 +1,6 @@
 #include "ir_private.h"
 #include "analysis/scope.h"
+#include "analysis/cache.h"
 
 #include "log.h"
 #include "list.h"
@@ -235,11 +236,11 @@ static void print_function(PrinterCtx* ctx, const Node* node) {
     printf("\n");
 
     if (node->arena->config.name_bound) {
-        Scope* scope = new_scope(node);
+        Scope* scope = get_scope(node);
         ctx->scope = scope;
         ctx->fn = node;
         print_abs_body(ctx, node);
-        destroy_scope(scope);
+        release_scope(scope);
     } else {
         print_abs_body(ctx, node);
     }
@@ -701,9 +702,9 @@ static void print_terminator(PrinterCtx* ctx, const Node* node) {
 
 static void print_decl(PrinterCtx* ctx, const Node* node) {
     assert(is_declaration(node));
-    if (ctx->config.skip_generated && lookup_annotation(node, "Generated"))
+    if (ctx->config.skip_generated && lookup_known_annotation(node, KnownAnnotationGenerated))
         return;
-    if (ctx->config.skip_builtin && lookup_annotation(node, "Builtin"))
+    if (ctx->config.skip_builtin && lookup_known_annotation(node, KnownAnnotationBuiltin))
         return;
 
     switch (node->tag) {
@@ -5,15 +5,15 @@
 #include "portability.h"
 #include "type.h"
 
-#include "dict.h"
+#include "id_table.h"
+#include "list.h"
 
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 
 #pragma GCC diagnostic error "-Wswitch-enum"
 
-KeyHash hash_node(Node**);
-bool compare_node(Node**, Node**);
-
 Rewriter create_rewriter(Module* src, Module* dst, RewriteFn fn) {
     return (Rewriter) {
         .src_arena = src->arena,
@@ -35,8 +35,8 @@ Rewriter create_rewriter(Module* src, Module* dst, RewriteFn fn) {
             .search_map = true,
             //.write_map = true,
         },
-        .map = new_dict(const Node*, Node*, (HashFn) hash_node, (CmpFn) compare_node),
-        .decls_map = new_dict(const Node*, Node*, (HashFn) hash_node, (CmpFn) compare_node),
+        .map = new_id_table(const Node*),
+        .decls_map = new_id_table(const Node*),
     };
 }
 
@@ -67,8 +67,82 @@ Rewriter create_substituter(Module* module) {
 
 void destroy_rewriter(Rewriter* r) {
     assert(r->map);
-    destroy_dict(r->map);
-    destroy_dict(r->decls_map);
+    assert(!r->worklist.pending || entries_count_list(r->worklist.pending) == 0);
+    destroy_id_table(r->map);
+    destroy_id_table(r->decls_map);
+    if (r->worklist.pending)
+        destroy_list(r->worklist.pending);
+}
+
+typedef struct {
+    /// either a lambda from deferred_lambda or a basic block
+    Node* abstraction;
+    const Node* old_body;
+    RewriteFn fn;
+} DeferredBody;
+
+static bool should_defer_bodies(const Rewriter* rewriter) {
+    return rewriter->config.worklist && rewriter->worklist.depth > 0 && rewriter->worklist.suspended == 0;
+}
+
+static void defer_body(Rewriter* rewriter, Node* abstraction, const Node* old_body, RewriteFn fn) {
+    if (!rewriter->worklist.pending)
+        rewriter->worklist.pending = new_list(DeferredBody);
+    DeferredBody deferred = { .abstraction = abstraction, .old_body = old_body, .fn = fn };
+    append_list(DeferredBody, rewriter->worklist.pending, deferred);
+}
+
+static void rewrite_deferred_bodies(Rewriter* rewriter) {
+    struct List* pending = rewriter->worklist.pending;
+    if (!pending)
+        return;
+    // rewriting a body defers the ones nested in it, they're appended to the list and handled by this same loop
+    for (size_t i = 0; i < entries_count_list(pending); i++) {
+        DeferredBody deferred = read_list(DeferredBody, pending)[i];
+        rewriter->worklist.depth++;
+        const Node* nbody = rewrite_node_with_fn(rewriter, deferred.old_body, deferred.fn);
+        rewriter->worklist.depth--;
+        if (deferred.abstraction->tag == AnonLambda_TAG)
+            finish_deferred_lambda(deferred.abstraction, nbody);
+        else
+            deferred.abstraction->payload.basic_block.body = nbody;
+    }
+    clear_list(pending);
+}
+
+typedef enum {
+    /// a declaration got looked up
+    DeclReferenced,
+    /// a declaration that wasn't processed yet starts getting rewritten, until the matching DeclFinished
+    DeclStarted,
+    DeclFinished,
+    /// a new declaration got added to the destination module
+    DeclCreated,
+    /// the function body that rewrite_module would rewrite here got staged instead
+    DeclBodyStaged,
+} DeclEventTag;
+
+typedef struct {
+    DeclEventTag tag;
+    /// the new declaration for DeclCreated, the old one otherwise
+    const Node* decl;
+} DeclEvent;
+
+typedef struct DeclOrder_ {
+    struct List* events;
+    size_t seen_decls;
+} DeclOrder;
+
+static void log_decl_event(const Rewriter* rewriter, DeclEventTag tag, const Node* decl) {
+    DeclOrder* order = rewriter->decl_order;
+    // the module only ever grows, whatever got added since the last event was created in between
+    size_t count = entries_count_list(rewriter->dst_module->decls);
+    for (; order->seen_decls < count; order->seen_decls++) {
+        DeclEvent created = { .tag = DeclCreated, .decl = read_list(const Node*, rewriter->dst_module->decls)[order->seen_decls] };
+        append_list(DeclEvent, order->events, created);
+    }
+    DeclEvent event = { .tag = tag, .decl = decl };
+    append_list(DeclEvent, order->events, event);
 }
 
 const Node* rewrite_node_with_fn(Rewriter* rewriter, const Node* node, RewriteFn fn) {
@@ -82,7 +156,21 @@ const Node* rewrite_node_with_fn(Rewriter* rewriter, const Node* node, RewriteFn
     if (found)
         return found;
 
-    const Node* rewritten = fn(rewriter, node);
+    bool log_decl = rewriter->decl_order && is_declaration(node);
+    if (log_decl)
+        log_decl_event(rewriter, DeclStarted, node);
+    const Node* rewritten;
+    if (rewriter->config.worklist) {
+        rewriter->worklist.depth++;
+        rewritten = fn(rewriter, node);
+        rewriter->worklist.depth--;
+        // the outermost call finishes everything that got deferred, one body at a time
+        if (rewriter->worklist.depth == 0)
+            rewrite_deferred_bodies(rewriter);
+    } else
+        rewritten = fn(rewriter, node);
+    if (log_decl)
+        log_decl_event(rewriter, DeclFinished, node);
     if (is_declaration(node))
         return rewritten;
     if (rewriter->config.write_map) {
@@ -110,10 +198,26 @@ Nodes rewrite_nodes_with_fn(Rewriter* rewriter, Nodes values, RewriteFn fn) {
     return nodes(rewriter->dst_arena, values.count, arr);
 }
 
+static const Node* import_staged_decl(const Rewriter* ctx, const Node* old) {
+    const Node** rewritten = find_value_id_table(const Node*, ctx->staging.decls, old->id);
+    if (!rewritten)
+        return NULL;
+    const Node* imported = rewrite_node(ctx->staging.importer, *rewritten);
+    insert_id_table(const Node*, ctx->decls_map, old->id, imported);
+    if (ctx->staging.refs)
+        append_list(const Node*, ctx->staging.refs, old);
+    return imported;
+}
+
 const Node* search_processed(const Rewriter* ctx, const Node* old) {
-    struct Dict* map = is_declaration(old) ? ctx->decls_map : ctx->map;
+    assert(old->arena == ctx->src_arena);
+    struct IdTable* map = is_declaration(old) ? ctx->decls_map : ctx->map;
     assert(map && "this rewriter has no processed cache");
-    const Node** found = find_value_dict(const Node*, const Node*, map, old);
+    if (ctx->decl_order && is_declaration(old))
+        log_decl_event(ctx, DeclReferenced, old);
+    const Node** found = find_value_id_table(const Node*, map, old->id);
+    if (!found && ctx->staging.decls && is_declaration(old))
+        return import_staged_decl(ctx, old);
     return found ? *found : NULL;
 }
 
@@ -139,9 +243,9 @@ void register_processed(Rewriter* ctx, const Node* old, const Node* new) {
         error("The same node got processed twice !");
     }
 #endif
-    struct Dict* map = is_declaration(old) ? ctx->decls_map : ctx->map;
+    struct IdTable* map = is_declaration(old) ? ctx->decls_map : ctx->map;
     assert(map && "this rewriter has no processed cache");
-    bool r = insert_dict_and_get_result(const Node*, const Node*, map, old, new);
+    bool r = insert_id_table(const Node*, map, old->id, new);
     assert(r);
 }
 
@@ -152,12 +256,9 @@ void register_processed_list(Rewriter* rewriter, Nodes old, Nodes new) {
 }
 
 void clear_processed_non_decls(Rewriter* rewriter) {
-    clear_dict(rewriter->map);
+    clear_id_table(rewriter->map);
 }
 
-KeyHash hash_node(Node**);
-bool compare_node(Node**, Node**);
-
 #pragma GCC diagnostic error "-Wswitch"
 
 #define rewrite_type rewriter->rewrite_field_type.rewrite_type
@@ -177,6 +278,241 @@ void rewrite_module(Rewriter* rewriter) {
     }
 }
 
+typedef struct {
+    const Node* old_fn;
+    Node* new_fn;
+    IrArena* staging_arena;
+    Module* staging_module;
+    /// copies the declarations from the destination module into the staging one
+    Rewriter importer;
+    const Node* staged_body;
+    /// the declarations the body refers to, see DeclBodyStaged
+    struct List* refs;
+} StagedBody;
+
+typedef struct {
+    const Rewriter* rewriter;
+    size_t ctx_size;
+    RewriteBodyFn rewrite_fn_body;
+    StagedBody* bodies;
+    size_t count;
+    size_t volatile next;
+} StagingQueue;
+
+static void stage_body(StagingQueue* queue, StagedBody* staged) {
+    const Rewriter* parent = queue->rewriter;
+    // one arena per function rather than per thread, so variable ids don't depend on scheduling either
+    staged->staging_arena = new_ir_arena(parent->dst_arena->config);
+    staged->staging_module = new_module(staged->staging_arena, get_module_name(parent->dst_module));
+    staged->importer = create_importer(parent->dst_module, staged->staging_module);
+
+    // everything in the pass context past the rewriter is shared by value
+    void* ctx = malloc(queue->ctx_size);
+    memcpy(ctx, parent, queue->ctx_size);
+    Rewriter* rewriter = (Rewriter*) ctx;
+    rewriter->dst_arena = staged->staging_arena;
+    rewriter->dst_module = staged->staging_module;
+    rewriter->map = new_id_table(const Node*);
+    rewriter->decls_map = new_id_table(const Node*);
+    memset(&rewriter->worklist, 0, sizeof(rewriter->worklist));
+    rewriter->staging.decls = clone_id_table(parent->decls_map);
+    rewriter->staging.importer = &staged->importer;
+
+    Node* staged_fn = (Node*) search_processed(rewriter, staged->old_fn);
+    staged->refs = new_list(const Node*);
+    rewriter->staging.refs = staged->refs;
+    register_processed_list(rewriter, staged->old_fn->payload.fun.params, staged_fn->payload.fun.params);
+    staged->staged_body = queue->rewrite_fn_body(rewriter, staged->old_fn, staged_fn);
+    assert(entries_count_list(staged->staging_module->decls) == entries_count_id_table(staged->importer.decls_map) && "function bodies may not add declarations when rewritten in parallel");
+
+    destroy_id_table(rewriter->staging.decls);
+    destroy_rewriter(rewriter);
+    free(ctx);
+}
+
+static void staging_worker(StagingQueue* queue) {
+    while (true) {
+        size_t i = atomic_fetch_increment(&queue->next);
+        if (i >= queue->count)
+            break;
+        stage_body(queue, &queue->bodies[i]);
+    }
+}
+
+/// Maps everything the importer copied into the staging arena back to the original
+static void register_reversed(struct IdTable* dst, const IrArena* src_arena, struct IdTable* src) {
+    size_t i = 0;
+    size_t id;
+    const Node* value;
+    while (id_table_iter(src, &i, &id, &value)) {
+        const Node* key = get_node_by_id(src_arena, (NodeId) id);
+        insert_id_table(const Node*, dst, value->id, key);
+    }
+}
+
+typedef struct {
+    DeclEvent* events;
+    /// for each DeclStarted event, the index of the matching DeclFinished
+    size_t* finished_at;
+    /// old declaration -> index of its DeclStarted event
+    struct IdTable* started_at;
+    struct IdTable* visited;
+    /// old function -> StagedBody*
+    struct IdTable* staged;
+    /// the new declarations, in the order rewrite_module would have created them
+    struct List* decls;
+    /// the StagedBody* in the order rewrite_module would have rewritten them
+    struct List* bodies;
+} DeclReplay;
+
+static void replay_decl(DeclReplay* replay, const Node* old);
+
+static void replay_events(DeclReplay* replay, size_t start, size_t end) {
+    for (size_t i = start; i < end; i++) {
+        DeclEvent event = replay->events[i];
+        switch (event.tag) {
+            case DeclReferenced: replay_decl(replay, event.decl); break;
+            // a nested declaration is replayed from wherever it's referenced first, which can be earlier than here
+            case DeclStarted: i = replay->finished_at[i]; break;
+            case DeclFinished: assert(false && "unbalanced declaration events"); break;
+            case DeclCreated: append_list(const Node*, replay->decls, event.decl); break;
+            case DeclBodyStaged: {
+                StagedBody* staged = *find_value_id_table(StagedBody*, replay->staged, event.decl->id);
+                append_list(StagedBody*, replay->bodies, staged);
+                size_t count = entries_count_list(staged->refs);
+                for (size_t j = 0; j < count; j++)
+                    replay_decl(replay, read_list(const Node*, staged->refs)[j]);
+                break;
+            }
+        }
+    }
+}
+
+static void replay_decl(DeclReplay* replay, const Node* old) {
+    if (!insert_id_set(replay->visited, old->id))
+        return;
+    size_t* started = find_value_id_table(size_t, replay->started_at, old->id);
+    if (!started)
+        return;
+    replay_events(replay, *started + 1, replay->finished_at[*started]);
+}
+
+/// Works out the order rewrite_module would have gone through the declarations in, and puts the new ones in that order.
+/// Returns the staged bodies in the order they should be merged in.
+static struct List* restore_serial_order(Rewriter* rewriter, DeclOrder* order, StagingQueue* queue) {
+    size_t count = entries_count_list(order->events);
+    DeclReplay replay = {
+        .events = read_list(DeclEvent, order->events),
+        .finished_at = calloc(count, sizeof(size_t)),
+        .started_at = new_id_table(size_t),
+        .visited = new_id_set(),
+        .staged = new_id_table(StagedBody*),
+        .decls = new_list(const Node*),
+        .bodies = new_list(StagedBody*),
+    };
+    struct List* open = new_list(size_t);
+    for (size_t i = 0; i < count; i++) {
+        if (replay.events[i].tag == DeclStarted) {
+            insert_id_table(size_t, replay.started_at, replay.events[i].decl->id, i);
+            append_list(size_t, open, i);
+        } else if (replay.events[i].tag == DeclFinished)
+            replay.finished_at[pop_last_list(size_t, open)] = i;
+    }
+    assert(entries_count_list(open) == 0);
+    destroy_list(open);
+    for (size_t i = 0; i < queue->count; i++) {
+        StagedBody* staged = &queue->bodies[i];
+        insert_id_table(StagedBody*, replay.staged, staged->old_fn->id, staged);
+    }
+
+    Nodes old_decls = get_module_declarations(rewriter->src_module);
+    for (size_t i = 0; i < old_decls.count; i++) {
+        if (old_decls.nodes[i]->tag == NominalType_TAG) continue;
+        replay_decl(&replay, old_decls.nodes[i]);
+    }
+    assert(entries_count_list(replay.bodies) == queue->count);
+    // nominal types nothing refers to never got visited, rewrite_module would not have created them at all
+    set_module_declarations(rewriter->dst_module, entries_count_list(replay.decls), read_list(const Node*, replay.decls));
+
+    free(replay.finished_at);
+    destroy_id_table(replay.started_at);
+    destroy_id_table(replay.visited);
+    destroy_id_table(replay.staged);
+    destroy_list(replay.decls);
+    return replay.bodies;
+}
+
+void rewrite_module_parallel(Rewriter* rewriter, size_t ctx_size, RewriteFn rewrite_fn_header, RewriteBodyFn rewrite_fn_body, size_t threads) {
+    assert(rewriter->src_arena != rewriter->dst_arena);
+    assert(ctx_size >= sizeof(Rewriter));
+    Nodes old_decls = get_module_declarations(rewriter->src_module);
+
+    StagingQueue queue = {
+        .rewriter = rewriter,
+        .ctx_size = ctx_size,
+        .rewrite_fn_body = rewrite_fn_body,
+        .bodies = calloc(old_decls.count, sizeof(StagedBody)),
+        .count = 0,
+        .next = 0,
+    };
+
+    DeclOrder order = { .events = new_list(DeclEvent) };
+    rewriter->decl_order = &order;
+    // function headers come first, so the other declarations can refer to functions without pulling their bodies in
+    for (size_t i = 0; i < old_decls.count; i++) {
+        const Node* old_fn = old_decls.nodes[i];
+        if (old_fn->tag != Function_TAG) continue;
+        log_decl_event(rewriter, DeclStarted, old_fn);
+        Node* new_fn = (Node*) rewrite_fn_header(rewriter, old_fn);
+        assert(new_fn->tag == Function_TAG && !new_fn->payload.fun.body);
+        assert(search_processed(rewriter, old_fn) == new_fn && "function headers need to be registered");
+        log_decl_event(rewriter, DeclBodyStaged, old_fn);
+        log_decl_event(rewriter, DeclFinished, old_fn);
+        queue.bodies[queue.count++] = (StagedBody) { .old_fn = old_fn, .new_fn = new_fn };
+    }
+    // unlike rewrite_module, nominal types are rewritten eagerly: bodies can't add declarations
+    for (size_t i = 0; i < old_decls.count; i++) {
+        if (old_decls.nodes[i]->tag == Function_TAG) continue;
+        rewrite_node_with_fn(rewriter, old_decls.nodes[i], rewrite_decl);
+    }
+    rewriter->decl_order = NULL;
+
+    // the workers read from both arenas, and passes may still intern helper nodes into them, from every thread
+    rewriter->src_arena->lock = new_mutex();
+    rewriter->dst_arena->lock = new_mutex();
+
+    size_t workers = threads < queue.count ? threads : queue.count;
+    LARRAY(Thread*, spawned, workers);
+    for (size_t i = 1; i < workers; i++)
+        spawned[i] = spawn_thread((void(*)(void*)) staging_worker, &queue);
+    staging_worker(&queue);
+    for (size_t i = 1; i < workers; i++)
+        join_thread(spawned[i]);
+
+    destroy_mutex(rewriter->src_arena->lock);
+    rewriter->src_arena->lock = NULL;
+    destroy_mutex(rewriter->dst_arena->lock);
+    rewriter->dst_arena->lock = NULL;
+
+    struct List* bodies = restore_serial_order(rewriter, &order, &queue);
+    destroy_list(order.events);
+
+    // merging in the same order as rewrite_module keeps the destination arena's contents deterministic
+    for (size_t i = 0; i < entries_count_list(bodies); i++) {
+        StagedBody* staged = read_list(StagedBody*, bodies)[i];
+        Rewriter merger = create_importer(staged->staging_module, rewriter->dst_module);
+        register_reversed(merger.decls_map, rewriter->dst_arena, staged->importer.decls_map);
+        register_reversed(merger.map, rewriter->dst_arena, staged->importer.map);
+        staged->new_fn->payload.fun.body = rewrite_node(&merger, staged->staged_body);
+        destroy_rewriter(&merger);
+        destroy_rewriter(&staged->importer);
+        destroy_list(staged->refs);
+        destroy_ir_arena(staged->staging_arena);
+    }
+    destroy_list(bodies);
+    free(queue.bodies);
+}
+
 const Node* recreate_variable(Rewriter* rewriter, const Node* old) {
     assert(old->tag == Variable_TAG);
     return var(rewriter->dst_arena, rewrite_node_with_fn(rewriter, old->payload.var.type, rewrite_type), old->payload.var.name);
@@ -267,6 +603,11 @@ static const Node* rebind_results(Rewriter* rewriter, const Node* ninstruction,
         new_params[i] = var(rewriter->dst_arena, ntypes.nodes[i], oparams.nodes[i]->payload.var.name);
         register_processed(rewriter, oparams.nodes[i], new_params[i]);
     }
+    if (should_defer_bodies(rewriter)) {
+        Node* tail = deferred_lambda(rewriter->dst_module, nodes(rewriter->dst_arena, oparams.count, new_params));
+        defer_body(rewriter, tail, olam->payload.anon_lam.body, rewriter->rewrite_fn);
+        return tail;
+    }
     const Node* nbody = rewrite_node(rewriter, olam->payload.anon_lam.body);
     const Node* tail = lambda(rewriter->dst_module, nodes(rewriter->dst_arena, oparams.count, new_params), nbody);
     return tail;
@@ -279,6 +620,14 @@ const Node* recreate_node_identity(Rewriter* rewriter, const Node* node) {
     assert(node->arena == rewriter->src_arena);
 
     IrArena* arena = rewriter->dst_arena;
+    // check_type_block and fold_let follow the let chain inside of blocks as soon as they're built
+    if (node->tag == Block_TAG && rewriter->config.worklist) {
+        rewriter->worklist.suspended++;
+        const Node* inside = rewrite_node_with_fn(rewriter, node->payload.block.inside, rewrite_terminator);
+        rewriter->worklist.suspended--;
+        return block(arena, (Block) { .inside = inside });
+    }
+
     #define REWRITE_FIELD_POD(t, n) .n = old_payload.n,
     #define REWRITE_FIELD_TYPE(t, n) .n = rewrite_node_with_fn(rewriter, old_payload.n, rewrite_type),
     #define REWRITE_FIELD_TYPES(t, n) .n = rewrite_nodes_with_fn(rewriter, old_payload.n, rewrite_type),
@@ -333,10 +682,22 @@ const Node* recreate_node_identity(Rewriter* rewriter, const Node* node) {
                 tail = rewrite_node_with_fn(rewriter, node->payload.let.tail, rewrite_anon_lambda);
             return let(arena, instruction, tail);
         }
-        case LetMut_TAG: error("De-sugar this by hand")
+        case LetMut_TAG: {
+            // only front-end code has those, before types are known
+            if (arena->config.check_types)
+                error("De-sugar this by hand")
+            const Node* instruction = rewrite_node_with_fn(rewriter, node->payload.let_mut.instruction, rewrite_instruction);
+            const Node* tail = rewrite_node_with_fn(rewriter, node->payload.let_mut.tail, rewrite_anon_lambda);
+            return let_mut(arena, instruction, tail);
+        }
         case AnonLambda_TAG: {
             Nodes params = recreate_variables(rewriter, node->payload.anon_lam.params);
             register_processed_list(rewriter, node->payload.anon_lam.params, params);
+            if (should_defer_bodies(rewriter)) {
+                Node* lam = deferred_lambda(rewriter->dst_module, params);
+                defer_body(rewriter, lam, node->payload.anon_lam.body, rewrite_terminator);
+                return lam;
+            }
             const Node* nterminator = rewrite_node_with_fn(rewriter, node->payload.anon_lam.body, rewrite_terminator);
             return lambda(rewriter->dst_module, params, nterminator);
         }
@@ -346,6 +707,10 @@ const Node* recreate_node_identity(Rewriter* rewriter, const Node* node) {
             const Node* fn = rewrite_node_with_fn(rewriter, node->payload.basic_block.fn, rewrite_decl);
             Node* bb = basic_block(arena, (Node*) fn, params, node->payload.basic_block.name);
             register_processed(rewriter, node, bb);
+            if (should_defer_bodies(rewriter)) {
+                defer_body(rewriter, bb, node->payload.basic_block.body, rewrite_terminator);
+                return bb;
+            }
             const Node* nterminator = rewrite_node_with_fn(rewriter, node->payload.basic_block.body, rewrite_terminator);
             bb->payload.basic_block.body = nterminator;
             return bb;
@@ -35,9 +35,32 @@ struct Rewriter_ {
     struct {
         bool search_map;
         bool write_map;
+        /// Rewrite the bodies of lambdas and basic blocks from a worklist instead of recursing into them, so long let chains
+        /// don't need a deep stack. Those bodies are only filled in once the outermost rewrite_node call returns, so the
+        /// rewrite functions may not look inside what they get back, nor keep state that depends on where they are in a body.
+        bool worklist;
     } config;
-    struct Dict* map;
-    struct Dict* decls_map;
+    /// processed nodes, indexed by the NodeId of the old node
+    struct IdTable* map;
+    struct IdTable* decls_map;
+    /// Bodies deferred by config.worklist
+    struct {
+        struct List* pending;
+        size_t depth;
+        /// nothing gets deferred while rewriting the inside of a block, it's looked at as soon as it's built
+        size_t suspended;
+    } worklist;
+    /// Only used while staging a function body, see rewrite_module_parallel
+    struct {
+        /// the declarations as rewritten into the actual destination module
+        struct IdTable* decls;
+        /// copies those into the staging arena the first time they are needed
+        struct Rewriter_* importer;
+        /// the declarations the body refers to, in the order it first does
+        struct List* refs;
+    } staging;
+    /// Only set on the thread running rewrite_module_parallel, records enough to put the declarations back in the order rewrite_module would have created them
+    struct DeclOrder_* decl_order;
 };
 
 Rewriter create_rewriter(Module* src, Module* dst, RewriteFn fn);
@@ -47,6 +70,19 @@ void destroy_rewriter(Rewriter*);
 
 void rewrite_module(Rewriter*);
 
+/// Produces the body of a function whose header was rewritten ahead of time into `new_fn`
+typedef const Node* (*RewriteBodyFn)(Rewriter*, const Node* old_fn, Node* new_fn);
+
+/// Like rewrite_module, but rewrites the function bodies on up to `threads` threads.
+/// Declarations are rewritten first on the calling thread, functions using `rewrite_fn_header` which must register the
+/// header it creates and leave the body alone. Each body is then rewritten by `rewrite_fn_body` into a private staging
+/// arena, through a copy of the pass context: `rewriter` has to be the first member of a context `ctx_size` bytes big.
+/// The declarations a body refers to are copied into its staging arena on demand, and only the function's own parameters
+/// count as processed when it starts. Rewriting a body must not add declarations to the module.
+/// The declarations end up in the order rewrite_module would have created them in, and the staged bodies are imported back in
+/// the order rewrite_module would have rewritten them, so the output is the same as the serial one for any number of threads.
+void rewrite_module_parallel(Rewriter* rewriter, size_t ctx_size, RewriteFn rewrite_fn_header, RewriteBodyFn rewrite_fn_body, size_t threads);
+
 /// Rewrites a node using the rewriter to provide the node and type operands
 const Node* recreate_node_identity(Rewriter*, const Node*);
 
@@ -0,0 +1,140 @@
+#include "stats.h"
+
+#include "ir_private.h"
+#include "list.h"
+#include "dict.h"
+#include "growy.h"
+#include "printer.h"
+
+#include <inttypes.h>
+
+typedef struct {
+    const char* name;
+    uint64_t time_ns;
+
+    size_t nodes;
+    size_t strings;
+    size_t nodes_lists;
+    size_t strings_lists;
+
+    /// what the nodes take up in the arena, and what they would if each was allocated as big as the whole payload union
+    size_t node_bytes;
+    size_t node_bytes_unpacked;
+
+    ArenaStats arena;
+    /// summed over all the interning sets of the arena
+    DictStats dicts;
+} PassStats;
+
+struct CompilerStats_ {
+    struct List* passes;
+};
+
+CompilerStats* new_compiler_stats() {
+    CompilerStats* stats = malloc(sizeof(CompilerStats));
+    *stats = (CompilerStats) {
+        .passes = new_list(PassStats),
+    };
+    return stats;
+}
+
+void destroy_compiler_stats(CompilerStats* stats) {
+    destroy_list(stats->passes);
+    free(stats);
+}
+
+static size_t arena_rounded(size_t size) {
+    size_t align = sizeof(max_align_t);
+    return (size + align - 1) / align * align;
+}
+
+static void count_node_bytes(PassStats* pass, IrArena* arena) {
+    size_t count = entries_count_list(arena->nodes_by_id);
+    const Node** nodes = read_list(const Node*, arena->nodes_by_id);
+    for (size_t i = 0; i < count; i++)
+        pass->node_bytes += arena_rounded(node_alloc_size(nodes[i]->tag));
+    pass->node_bytes_unpacked = count * arena_rounded(sizeof(Node));
+}
+
+static void add_dict_stats(DictStats* acc, const struct Dict* dict) {
+    DictStats s = dict_stats(dict);
+    acc->lookups += s.lookups;
+    acc->groups_probed += s.groups_probed;
+    acc->key_comparisons += s.key_comparisons;
+    acc->rehashes += s.rehashes;
+}
+
+void enable_ir_arena_stats(IrArena* arena) {
+    enable_dict_stats(arena->node_set);
+    enable_dict_stats(arena->string_set);
+    enable_dict_stats(arena->nodes_set);
+    enable_dict_stats(arena->strings_set);
+}
+
+void record_pass_stats(CompilerStats* stats, const char* pass_name, uint64_t time_ns, IrArena* produced) {
+    PassStats pass = {
+        .name = pass_name,
+        .time_ns = time_ns,
+        .nodes = entries_count_dict(produced->node_set),
+        .strings = entries_count_dict(produced->string_set),
+        .nodes_lists = entries_count_dict(produced->nodes_set),
+        .strings_lists = entries_count_dict(produced->strings_set),
+        .arena = arena_stats(produced->arena),
+    };
+    count_node_bytes(&pass, produced);
+    add_dict_stats(&pass.dicts, produced->node_set);
+    add_dict_stats(&pass.dicts, produced->string_set);
+    add_dict_stats(&pass.dicts, produced->nodes_set);
+    add_dict_stats(&pass.dicts, produced->strings_set);
+    append_list(PassStats, stats->passes, pass);
+}
+
+void trace_ir_arenas_size(IrArena* a, IrArena* b) {
+    uint64_t bytes = 0;
+    if (a)
+        bytes += arena_stats(a->arena).reserved;
+    if (b)
+        bytes += arena_stats(b->arena).reserved;
+    trace_counter("IR arena bytes", bytes);
+}
+
+void print_compiler_stats(const CompilerStats* stats, FILE* f) {
+    size_t count = entries_count_list(stats->passes);
+    uint64_t total_ns = 0;
+    size_t peak_node_bytes = 0, peak_node_bytes_unpacked = 0;
+    fprintf(f, "%-28s %10s %8s %8s %10s %10s %12s %8s\n", "pass", "time (ms)", "nodes", "strings", "arena KiB", "nodes KiB", "dict lookups", "probes");
+    for (size_t i = 0; i < count; i++) {
+        PassStats pass = read_list(PassStats, stats->passes)[i];
+        total_ns += pass.time_ns;
+        double probes = pass.dicts.lookups ? (double) pass.dicts.groups_probed / (double) pass.dicts.lookups : 0.0;
+        fprintf(f, "%-28s %10.3f %8zu %8zu %10zu %10zu %12zu %8.2f\n", pass.name, (double) pass.time_ns / 1000000.0, pass.nodes, pass.strings, pass.arena.used / 1024, pass.node_bytes / 1024, pass.dicts.lookups, probes);
+        if (pass.node_bytes > peak_node_bytes) {
+            peak_node_bytes = pass.node_bytes;
+            peak_node_bytes_unpacked = pass.node_bytes_unpacked;
+        }
+    }
+    fprintf(f, "%-28s %10.3f\n", "total", (double) total_ns / 1000000.0);
+    fprintf(f, "largest module: %zu KiB of nodes, %zu KiB if every node took sizeof(Node)\n", peak_node_bytes / 1024, peak_node_bytes_unpacked / 1024);
+}
+
+void compiler_stats_to_json(const CompilerStats* stats, char** str_ptr, size_t* size) {
+    Growy* g = new_growy();
+    Printer* p = open_growy_as_printer(g);
+    size_t count = entries_count_list(stats->passes);
+    uint64_t total_ns = 0;
+    print(p, "{\n    \"passes\": [");
+    for (size_t i = 0; i < count; i++) {
+        PassStats pass = read_list(PassStats, stats->passes)[i];
+        total_ns += pass.time_ns;
+        print(p, "%s\n        {", i > 0 ? "," : "");
+        print(p, " \"name\": \"%s\", \"time_ns\": %" PRIu64 ",", pass.name, pass.time_ns);
+        print(p, " \"nodes\": %zu, \"strings\": %zu, \"nodes_lists\": %zu, \"strings_lists\": %zu,", pass.nodes, pass.strings, pass.nodes_lists, pass.strings_lists);
+        print(p, " \"node_bytes\": %zu, \"node_bytes_unpacked\": %zu,", pass.node_bytes, pass.node_bytes_unpacked);
+        print(p, " \"arena\": { \"reserved\": %zu, \"used\": %zu, \"blocks\": %zu },", pass.arena.reserved, pass.arena.used, pass.arena.blocks);
+        print(p, " \"dicts\": { \"lookups\": %zu, \"groups_probed\": %zu, \"key_comparisons\": %zu, \"rehashes\": %zu } }", pass.dicts.lookups, pass.dicts.groups_probed, pass.dicts.key_comparisons, pass.dicts.rehashes);
+    }
+    print(p, "\n    ],\n    \"total_time_ns\": %" PRIu64 "\n}\n", total_ns);
+    destroy_printer(p);
+    *size = growy_size(g);
+    *str_ptr = growy_deconstruct(g);
+}
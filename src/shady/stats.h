@@ -0,0 +1,15 @@
+#ifndef SHADY_STATS_H
+#define SHADY_STATS_H
+
+#include "shady/ir.h"
+
+#include <stdint.h>
+
+/// Starts counting the lookups in the interning dicts of the arena a pass is about to produce
+void enable_ir_arena_stats(IrArena*);
+/// Records the state of the arena produced by a pass, along with the time it took
+void record_pass_stats(CompilerStats*, const char* pass_name, uint64_t time_ns, IrArena* produced);
+/// Emits a trace counter with the bytes reserved by the arenas alive across a pass, either may be NULL
+void trace_ir_arenas_size(IrArena* a, IrArena* b);
+
+#endif
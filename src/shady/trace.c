@@ -0,0 +1,103 @@
+#include "shady/ir.h"
+
+#include "log.h"
+#include "portability.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+
+/// Writes events in the JSON array flavour of the Chrome trace event format
+typedef struct {
+    FILE* file;
+    Mutex* lock;
+    uint64_t start_time;
+    bool first_event;
+} TraceSink;
+
+static TraceSink* volatile sink = NULL;
+
+static size_t volatile next_thread_id = 1;
+static SHADY_THREAD_LOCAL size_t thread_id = 0;
+
+static size_t get_thread_id() {
+    if (thread_id == 0)
+        thread_id = atomic_fetch_increment(&next_thread_id);
+    return thread_id;
+}
+
+static void stop_tracing_at_exit() {
+    stop_tracing();
+}
+
+bool start_tracing(const char* filename) {
+    static bool registered_at_exit = false;
+    if (sink) {
+        error_print("Tracing has already been started\n");
+        return false;
+    }
+    FILE* f = fopen(filename, "wb");
+    if (!f) {
+        error_print("Could not open trace file '%s'\n", filename);
+        return false;
+    }
+    fprintf(f, "[");
+
+    TraceSink* new_sink = malloc(sizeof(TraceSink));
+    *new_sink = (TraceSink) {
+        .file = f,
+        .lock = new_mutex(),
+        .start_time = get_time_nano(),
+        .first_event = true,
+    };
+    sink = new_sink;
+
+    if (!registered_at_exit) {
+        atexit(stop_tracing_at_exit);
+        registered_at_exit = true;
+    }
+    return true;
+}
+
+void stop_tracing() {
+    TraceSink* old_sink = sink;
+    if (!old_sink)
+        return;
+    sink = NULL;
+    fprintf(old_sink->file, "\n]\n");
+    fclose(old_sink->file);
+    destroy_mutex(old_sink->lock);
+    free(old_sink);
+}
+
+static void emit_event(TraceSink* s, const char* name, char phase, const uint64_t* counter_value) {
+    uint64_t now = get_time_nano();
+    size_t tid = get_thread_id();
+    lock_mutex(s->lock);
+    fprintf(s->file, "%s\n{\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%zu", s->first_event ? "" : ",", phase, (double) (now - s->start_time) / 1000.0, tid);
+    if (name)
+        fprintf(s->file, ",\"name\":\"%s\"", name);
+    if (counter_value)
+        fprintf(s->file, ",\"args\":{\"value\":%" PRIu64 "}", *counter_value);
+    fprintf(s->file, "}");
+    s->first_event = false;
+    unlock_mutex(s->lock);
+}
+
+void trace_begin(const char* name) {
+    TraceSink* s = sink;
+    if (s)
+        emit_event(s, name, 'B', NULL);
+}
+
+void trace_end() {
+    TraceSink* s = sink;
+    if (s)
+        emit_event(s, NULL, 'E', NULL);
+}
+
+void trace_counter(const char* name, uint64_t value) {
+    TraceSink* s = sink;
+    if (s)
+        emit_event(s, name, 'C', &value);
+}
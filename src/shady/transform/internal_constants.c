@@ -21,14 +21,12 @@ Nodes generate_dummy_constants(SHADY_UNUSED CompilerConfig* config, Module* mod)
 
 void patch_constants(CompilerConfig* config, Module* mod) {
     IrArena* arena = get_module_arena(mod);
-    Nodes decls = get_module_declarations(mod);
-    for (size_t i = 0; i < decls.count; i++) {
-        Node* decl = (Node*) decls.nodes[i];
-        if (decl->tag != Constant_TAG) continue;
 #define X(name, T, placeholder, real) \
-        if (strcmp(get_decl_name(decl), #name) == 0) \
-            decl->payload.constant.value = real;
-        INTERNAL_CONSTANTS(X)
-#undef X
+    { \
+        Node* decl = get_declaration(mod, #name); \
+        if (decl && decl->tag == Constant_TAG) \
+            decl->payload.constant.value = real; \
     }
+    INTERNAL_CONSTANTS(X)
+#undef X
 }
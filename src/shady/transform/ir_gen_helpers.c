@@ -93,14 +93,9 @@ const Node* gen_lea(BodyBuilder* instructions, const Node* base, const Node* off
 }
 
 const Node* find_or_process_decl(Rewriter* rewriter, Module* mod, const char* name) {
-    Nodes old_decls = get_module_declarations(mod);
-    for (size_t i = 0; i < old_decls.count; i++) {
-        const Node* decl = old_decls.nodes[i];
-        if (strcmp(get_decl_name(decl), name) == 0) {
-            return rewrite_node(rewriter, decl);
-        }
-    }
-    assert(false);
+    const Node* decl = get_declaration(mod, name);
+    assert(decl);
+    return rewrite_node(rewriter, decl);
 }
 
 const Node* access_decl(Rewriter* rewriter, Module* mod, const char* name) {
@@ -3,18 +3,59 @@
 
 #include "log.h"
 #include "portability.h"
+#include "id_table.h"
 
 #include "../type.h"
 
 #include <assert.h>
+#include <string.h>
 
 inline static size_t round_up(size_t a, size_t b) {
     size_t divided = (a + b - 1) / b;
     return divided * b;
 }
 
-TypeMemLayout get_record_layout(const CompilerConfig* config, IrArena* arena, const Node* record_type, FieldLayout* fields) {
-    assert(record_type->tag == RecordType_TAG);
+/// What IrArena.mem_layouts holds for each type that was laid out
+typedef struct {
+    TypeMemLayout layout;
+    /// one per member for record types, NULL otherwise
+    FieldLayout* fields;
+} CachedMemLayout;
+
+/// Only types from the arena doing the layout are cached, their ids mean nothing to another arena
+static const CachedMemLayout* find_cached_layout(IrArena* arena, const Type* type) {
+    if (type->arena != arena)
+        return NULL;
+    lock_ir_arena(arena);
+    const CachedMemLayout* found = arena->mem_layouts ? find_value_id_table(CachedMemLayout, arena->mem_layouts, type->id) : NULL;
+    unlock_ir_arena(arena);
+    return found;
+}
+
+/// Layouts are computed without holding the lock (it needs to intern types), so another thread might have beaten us to it
+static const CachedMemLayout* cache_layout(IrArena* arena, const Type* type, TypeMemLayout layout, const FieldLayout* fields, size_t fields_count) {
+    assert(type->arena == arena);
+    lock_ir_arena(arena);
+    if (!arena->mem_layouts)
+        arena->mem_layouts = new_id_table(CachedMemLayout);
+    CachedMemLayout* found = find_value_id_table(CachedMemLayout, arena->mem_layouts, type->id);
+    if (!found) {
+        CachedMemLayout entry = {
+            .layout = layout,
+            .fields = NULL,
+        };
+        if (fields_count > 0) {
+            entry.fields = arena_alloc_uninit(arena->arena, sizeof(FieldLayout) * fields_count);
+            memcpy(entry.fields, fields, sizeof(FieldLayout) * fields_count);
+        }
+        insert_id_table(CachedMemLayout, arena->mem_layouts, type->id, entry);
+        found = find_value_id_table(CachedMemLayout, arena->mem_layouts, type->id);
+    }
+    unlock_ir_arena(arena);
+    return found;
+}
+
+static TypeMemLayout compute_record_layout(const CompilerConfig* config, IrArena* arena, const Node* record_type, FieldLayout* fields) {
 
     size_t offset = 0;
     size_t max_align = 0;
@@ -39,17 +80,41 @@ TypeMemLayout get_record_layout(const CompilerConfig* config, IrArena* arena, co
     };
 }
 
+/// Lays the record out once, along with the offsets of all its fields
+static const CachedMemLayout* get_cached_record_layout(const CompilerConfig* config, IrArena* arena, const Node* record_type) {
+    const CachedMemLayout* cached = find_cached_layout(arena, record_type);
+    if (cached)
+        return cached;
+    size_t members_count = record_type->payload.record_type.members.count;
+    LARRAY(FieldLayout, fields, members_count);
+    TypeMemLayout layout = compute_record_layout(config, arena, record_type, fields);
+    return cache_layout(arena, record_type, layout, fields, members_count);
+}
+
+TypeMemLayout get_record_layout(const CompilerConfig* config, IrArena* arena, const Node* record_type, FieldLayout* fields) {
+    assert(record_type->tag == RecordType_TAG);
+    if (record_type->arena != arena)
+        return compute_record_layout(config, arena, record_type, fields);
+
+    const CachedMemLayout* cached = get_cached_record_layout(config, arena, record_type);
+    if (fields)
+        memcpy(fields, cached->fields, sizeof(FieldLayout) * record_type->payload.record_type.members.count);
+    return cached->layout;
+}
+
 size_t get_record_field_offset_in_bytes(const CompilerConfig* c, IrArena* a, const Type* t, size_t i) {
     assert(t->tag == RecordType_TAG);
     Nodes member_types = t->payload.record_type.members;
     assert(i < member_types.count);
-    LARRAY(FieldLayout, fields, member_types.count);
-    get_record_layout(c, a, t, fields);
-    return fields[i].offset_in_bytes;
+    if (t->arena != a) {
+        LARRAY(FieldLayout, fields, member_types.count);
+        compute_record_layout(c, a, t, fields);
+        return fields[i].offset_in_bytes;
+    }
+    return get_cached_record_layout(c, a, t)->fields[i].offset_in_bytes;
 }
 
-TypeMemLayout get_mem_layout(const CompilerConfig* config, IrArena* arena, const Type* type) {
-    assert(is_type(type));
+static TypeMemLayout compute_mem_layout(const CompilerConfig* config, IrArena* arena, const Type* type) {
     switch (type->tag) {
         case FnType_TAG:  error("Functions have an opaque memory representation");
         case PtrType_TAG: switch (type->payload.ptr_type.address_space) {
@@ -93,3 +158,14 @@ TypeMemLayout get_mem_layout(const CompilerConfig* config, IrArena* arena, const
         default: error("not a known type");
     }
 }
+
+TypeMemLayout get_mem_layout(const CompilerConfig* config, IrArena* arena, const Type* type) {
+    assert(is_type(type));
+    const CachedMemLayout* cached = find_cached_layout(arena, type);
+    if (cached)
+        return cached->layout;
+    TypeMemLayout layout = compute_mem_layout(config, arena, type);
+    if (type->arena == arena)
+        cache_layout(arena, type, layout, NULL, 0);
+    return layout;
+}
@@ -2,45 +2,80 @@
 #include "log.h"
 #include "visit.h"
 #include "portability.h"
+#include "list.h"
 
 #include "analysis/scope.h"
+#include "analysis/cache.h"
 
 #include <assert.h>
 
 static void visit_node(Visitor* visitor, const Node* node) {
-    if (node && visitor->visit_fn)
+    if (!node || !visitor->visit_fn)
+        return;
+    if (visitor->pending)
+        append_list(const Node*, visitor->pending, node);
+    else
         visitor->visit_fn(visitor, node);
 }
 
-void visit_nodes(Visitor* visitor, Nodes nodes) {
+/// Nodes get pushed in the order they should be visited, this flips the ones pushed since `first` so they get popped in that order
+static void flip_pending(Visitor* visitor, size_t first) {
+    if (!visitor->pending)
+        return;
+    const Node** pending = read_list(const Node*, visitor->pending);
+    size_t last = entries_count_list(visitor->pending);
+    while (first + 1 < last) {
+        const Node* tmp = pending[first];
+        pending[first++] = pending[--last];
+        pending[last] = tmp;
+    }
+}
+
+static size_t pending_count(Visitor* visitor) {
+    return visitor->pending ? entries_count_list(visitor->pending) : 0;
+}
+
+static void push_nodes(Visitor* visitor, Nodes nodes) {
     for (size_t i = 0; i < nodes.count; i++) {
          visit_node(visitor, nodes.nodes[i]);
     }
 }
 
-void visit_fn_blocks_except_head(Visitor* visitor, const Node* function) {
+void visit_nodes(Visitor* visitor, Nodes nodes) {
+    size_t first = pending_count(visitor);
+    push_nodes(visitor, nodes);
+    flip_pending(visitor, first);
+}
+
+static void push_fn_blocks_except_head(Visitor* visitor, const Node* function) {
     assert(function->tag == Function_TAG);
-    Scope* scope = new_scope(function);
+    Scope* scope = get_scope(function);
     assert(scope->rpo[0]->node == function);
     for (size_t i = 1; i < scope->size; i++) {
         visit_node(visitor, scope->rpo[i]->node);
     }
-    destroy_scope(scope);
+    release_scope(scope);
+}
+
+void visit_fn_blocks_except_head(Visitor* visitor, const Node* function) {
+    size_t first = pending_count(visitor);
+    push_fn_blocks_except_head(visitor, function);
+    flip_pending(visitor, first);
 }
 
 #pragma GCC diagnostic error "-Wswitch"
 
 #define visit_type(n) visit_node(visitor, n)
-#define visit_types(ns) visit_nodes(visitor, ns)
+#define visit_types(ns) push_nodes(visitor, ns)
 #define visit_value(n) visit_node(visitor, n)
-#define visit_values(ns) visit_nodes(visitor, ns)
+#define visit_values(ns) push_nodes(visitor, ns)
 #define visit_instruction(n) visit_node(visitor, n)
 #define visit_terminator(n) visit_node(visitor, n)
 #define visit_decl(n) visit_node(visitor, n)
 #define visit_anon_lambda(n) visit_node(visitor, n)
-#define visit_anon_lambdas(ns) visit_nodes(visitor, ns)
+#define visit_anon_lambdas(ns) push_nodes(visitor, ns)
 #define visit_basic_block(n) visit_node(visitor, n)
-#define visit_basic_blocks(ns) visit_nodes(visitor, ns)
+#define visit_basic_blocks(ns) push_nodes(visitor, ns)
 
 #define VISIT_FIELD_POD(t, n)
 #define VISIT_FIELD_STRING(t, n)
@@ -61,17 +96,17 @@ void visit_fn_blocks_except_head(Visitor* visitor, const Node* function) {
 #define VISIT_FIELD_BASIC_BLOCK(t, n) if (visitor->visit_continuations) visit_basic_block(payload.n);
 #define VISIT_FIELD_BASIC_BLOCKS(t, n) if (visitor->visit_continuations) visit_basic_blocks(payload.n);
 
-void visit_children(Visitor* visitor, const Node* node) {
+static void push_children(Visitor* visitor, const Node* node) {
     if (!node_type_has_payload[node->tag])
         return;
 
     if (node->tag == Function_TAG) {
-        visit_nodes(visitor, node->payload.fun.params);
-        visit_nodes(visitor, node->payload.fun.return_types);
+        push_nodes(visitor, node->payload.fun.params);
+        push_nodes(visitor, node->payload.fun.return_types);
         if (node->payload.fun.body)
             visit_node(visitor, node->payload.fun.body);
         if (visitor->visit_fn_scope_rpo)
-            visit_fn_blocks_except_head(visitor, node);
+            push_fn_blocks_except_head(visitor, node);
     }
 
     switch(node->tag) {
@@ -84,6 +119,30 @@ void visit_children(Visitor* visitor, const Node* node) {
     }
 }
 
+void visit_children(Visitor* visitor, const Node* node) {
+    if (!visitor->worklist) {
+        push_children(visitor, node);
+        return;
+    }
+
+    // nested calls only push the children, the outermost one visits everything
+    bool outermost = !visitor->pending;
+    if (outermost)
+        visitor->pending = new_list(const Node*);
+    size_t first = entries_count_list(visitor->pending);
+    push_children(visitor, node);
+    flip_pending(visitor, first);
+    if (!outermost)
+        return;
+
+    while (entries_count_list(visitor->pending) > 0) {
+        const Node* child = pop_last_list(const Node*, visitor->pending);
+        visitor->visit_fn(visitor, child);
+    }
+    destroy_list(visitor->pending);
+    visitor->pending = NULL;
+}
+
 void visit_module(Visitor* visitor, Module* mod) {
     Nodes decls = get_module_declarations(mod);
     visit_nodes(visitor, decls);
@@ -14,6 +14,11 @@ struct Visitor_ {
    bool visit_continuations;
    // Enabling this will make visit_children visit references to other declarations (visit_module will still visit those at the top)
    bool visit_referenced_decls;
+   // Enabling this will make visit_children push the children on an explicit stack instead of recursing into them, they get visited in the same (pre-)order
+   // once the outermost visit_children call drains it. Only use this if visit_fn does not care about what happens after it calls visit_children.
+   bool worklist;
+   // Nodes waiting to be visited, used by the worklist mode
+   struct List* pending;
 };
 
 void visit_children(Visitor*, const Node*);
@@ -5,10 +5,10 @@
 
 #include "log.h"
 #include "portability.h"
+#include "util.h"
 
 #include <stdlib.h>
 #include <string.h>
-#include <assert.h>
 
 #pragma GCC diagnostic error "-Wswitch"
 
@@ -21,6 +21,15 @@ typedef struct {
     const char*     output_filename;
     const char* shd_output_filename;
     const char* cfg_output_filename;
+
+    bool time_passes;
+    const char* stats_filename;
+
+    // Batch mode: every input is compiled as a separate program
+    bool batch;
+    const char* manifest_filename;
+    const char* output_dir;
+    size_t jobs;
 } SlimConfig;
 
 static void parse_slim_arguments(SlimConfig* args, int* pargc, char** argv) {
@@ -71,6 +80,44 @@ static void parse_slim_arguments(SlimConfig* args, int* pargc, char** argv) {
             invalid_target:
             error_print("--target must be followed with a valid target (see help for list of targets)");
             exit(InvalidTarget);
+        } else if (strcmp(argv[i], "--time-passes") == 0) {
+            args->time_passes = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            argv[i] = NULL;
+            i++;
+            if (i == argc) {
+                error_print("--stats must be followed with a filename");
+                exit(MissingStatsArg);
+            }
+            args->stats_filename = argv[i];
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            args->batch = true;
+        } else if (strcmp(argv[i], "--manifest") == 0) {
+            argv[i] = NULL;
+            i++;
+            if (i == argc) {
+                error_print("--manifest must be followed with a filename");
+                exit(MissingManifestArg);
+            }
+            args->batch = true;
+            args->manifest_filename = argv[i];
+        } else if (strcmp(argv[i], "--output-dir") == 0) {
+            argv[i] = NULL;
+            i++;
+            if (i == argc) {
+                error_print("--output-dir must be followed with a directory");
+                exit(MissingOutputDirArg);
+            }
+            args->output_dir = argv[i];
+        } else if (strcmp(argv[i], "--jobs") == 0 || strcmp(argv[i], "-j") == 0) {
+            argv[i] = NULL;
+            i++;
+            int jobs = i == argc ? 0 : atoi(argv[i]);
+            if (jobs <= 0) {
+                error_print("--jobs must be followed with a positive number");
+                exit(InvalidJobCount);
+            }
+            args->jobs = (size_t) jobs;
         } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
             help = true;
             continue;
@@ -82,20 +129,298 @@ static void parse_slim_arguments(SlimConfig* args, int* pargc, char** argv) {
 
     if (help) {
         error_print("Usage: slim source.slim\n");
+        error_print("       slim --batch [--output-dir <dir>] source1.slim source2.slim ...\n");
+        error_print("       slim --manifest <filename>\n");
         error_print("Available arguments: \n");
         error_print("  --target <c, glsl, ispc, spirv>           \n");
         error_print("  --output <filename>, -o <filename>        \n");
         error_print("  --dump-cfg <filename>                     Dumps the control flow graph of the final IR\n");
         error_print("  --dump-ir <filename>                      Dumps the final IR\n");
+        error_print("  --time-passes                             Prints how long each pass took and how much IR it produced\n");
+        error_print("  --stats <filename>                        Writes per-pass statistics as JSON\n");
+        error_print("  --batch                                   Compiles each input file into its own output\n");
+        error_print("  --manifest <filename>                     Batch-compiles the '<input> <output>' pairs listed in the file, one per line\n");
+        error_print("  --output-dir <dir>                        Where batch outputs go, defaults to next to each input\n");
+        error_print("  --jobs <n>, -j <n>                        Number of batch compilations to run at once, defaults to the number of cores\n");
     }
 
     pack_remaining_args(pargc, argv);
 }
 
-int main(int argc, char** argv) {
-    platform_specific_terminal_init_extras();
+typedef struct {
+    size_t num_input_files;
+    const char** input_filenames;
+    const char* output_filename;
+    const char* shd_output_filename;
+    const char* cfg_output_filename;
+    const char* stats_filename;
+} SlimJob;
+
+/// Logs and returns NULL instead of asserting, so one unwritable output only fails its own job
+static FILE* open_output(const char* filename) {
+    FILE* f = fopen(filename, "wb");
+    if (!f)
+        error_print("could not open '%s' for writing\n", filename);
+    return f;
+}
+
+/// Returns NoError, or what went wrong. Never exits: in batch mode this runs on a worker thread, next to other jobs.
+static int compile_job(const SlimConfig* args, const SlimJob* job) {
+    CompilerConfig config = args->config;
+    CEmitterConfig c_emitter_config = args->c_emitter_config;
+    CodegenTarget target = args->target;
+    if (args->time_passes || job->stats_filename)
+        config.stats = new_compiler_stats();
 
+    int status = NoError;
     IrArena* arena = new_ir_arena(default_arena_config());
+    Module* mod = new_module(arena, "my_module");
+
+    CompilationResult parse_result = parse_files(&config, job->num_input_files, job->input_filenames, NULL, mod);
+    if (parse_result != CompilationNoError) {
+        error_print("Parsing %s failed, errcode=%d\n", job->input_filenames[0], (int) parse_result);
+        status = parse_result == CompilationInputNotFound ? InputFileDoesNotExist : CompilationFailed;
+        goto cleanup;
+    }
+
+    info_print("Parsed program successfully: \n");
+    log_module(INFO, &config, mod);
+
+    CompilationResult result = run_compiler_passes(&config, &mod);
+    if (result != CompilationNoError) {
+        error_print("Compilation pipeline failed for %s, errcode=%d\n", job->input_filenames[0], (int) result);
+        status = CompilationFailed;
+        goto cleanup;
+    }
+    info_print("Ran all passes successfully\n");
+
+    if (args->time_passes) {
+        if (job->output_filename)
+            fprintf(stderr, "Passes for %s:\n", job->output_filename);
+        print_compiler_stats(config.stats, stderr);
+    }
+
+    if (job->stats_filename) {
+        FILE* f = open_output(job->stats_filename);
+        if (f) {
+            size_t output_size;
+            char* output_buffer;
+            compiler_stats_to_json(config.stats, &output_buffer, &output_size);
+            fwrite(output_buffer, output_size, 1, f);
+            free((void*) output_buffer);
+            fclose(f);
+            info_print("Stats dumped\n");
+        } else status = CannotOpenOutput;
+    }
+
+    if (job->cfg_output_filename) {
+        FILE* f = open_output(job->cfg_output_filename);
+        if (f) {
+            dump_cfg(f, mod);
+            fclose(f);
+            info_print("CFG dumped\n");
+        } else status = CannotOpenOutput;
+    }
+
+    if (job->shd_output_filename) {
+        FILE* f = open_output(job->shd_output_filename);
+        if (f) {
+            size_t output_size;
+            char* output_buffer;
+            print_module_into_str(mod, &output_buffer, &output_size);
+            fwrite(output_buffer, output_size, 1, f);
+            free((void*) output_buffer);
+            fclose(f);
+            info_print("IR dumped\n");
+        } else status = CannotOpenOutput;
+    }
+
+    if (job->output_filename) {
+        c_emitter_config.config = &config;
+        if (target == TgtAuto)
+            target = guess_target(job->output_filename);
+        FILE* f = open_output(job->output_filename);
+        if (f) {
+            size_t output_size;
+            char* output_buffer;
+            switch (target) {
+                case TgtAuto: SHADY_UNREACHABLE;
+                case TgtSPV: emit_spirv(&config, mod, &output_size, &output_buffer, NULL); break;
+                case TgtC:
+                    c_emitter_config.dialect = C;
+                    emit_c(c_emitter_config, mod, &output_size, &output_buffer, NULL);
+                    break;
+                case TgtGLSL:
+                    c_emitter_config.dialect = GLSL;
+                    emit_c(c_emitter_config, mod, &output_size, &output_buffer, NULL);
+                    break;
+                case TgtISPC:
+                    c_emitter_config.dialect = ISPC;
+                    emit_c(c_emitter_config, mod, &output_size, &output_buffer, NULL);
+                    break;
+            }
+            fwrite(output_buffer, output_size, 1, f);
+            free((void*) output_buffer);
+            fclose(f);
+        } else status = CannotOpenOutput;
+    }
+    info_print("Done\n");
+
+    cleanup:
+    if (config.stats)
+        destroy_compiler_stats(config.stats);
+    if (get_module_arena(mod) != arena)
+        destroy_ir_arena(get_module_arena(mod));
+    destroy_ir_arena(arena);
+    return status;
+}
+
+static const char* target_extension(CodegenTarget target) {
+    switch (target) {
+        case TgtAuto:
+        case TgtSPV: return ".spv";
+        case TgtC: return ".c";
+        case TgtGLSL: return ".glsl";
+        case TgtISPC: return ".ispc";
+    }
+    SHADY_UNREACHABLE;
+}
+
+/// Swaps the extension of the input for the target's one, and moves it into output_dir if there is one
+static char* batch_output_filename(const SlimConfig* args, const char* input_filename) {
+    const char* base = input_filename;
+    if (args->output_dir) {
+        for (const char* c = input_filename; *c; c++) {
+            if (*c == '/' || *c == '\\')
+                base = c + 1;
+        }
+    }
+    size_t base_len = strlen(base);
+    for (size_t i = base_len; i > 0; i--) {
+        if (base[i - 1] == '.') {
+            base_len = i - 1;
+            break;
+        }
+        if (base[i - 1] == '/' || base[i - 1] == '\\')
+            break;
+    }
+
+    const char* dir = args->output_dir ? args->output_dir : "";
+    const char* sep = args->output_dir ? "/" : "";
+    const char* ext = target_extension(args->target);
+    size_t len = strlen(dir) + strlen(sep) + base_len + strlen(ext);
+    char* output = malloc(len + 1);
+    strcpy(output, dir);
+    strcat(output, sep);
+    strncat(output, base, base_len);
+    strcat(output, ext);
+    return output;
+}
+
+/// Reads '<input> <output>' pairs, one per line. The returned strings point into *contents, which the caller frees.
+static void parse_manifest(const char* filename, struct List* jobs, struct List* filenames, char** contents) {
+    if (!read_file(filename, NULL, (unsigned char**) contents)) {
+        error_print("could not read manifest '%s'\n", filename);
+        exit(InputFileDoesNotExist);
+    }
+
+    char* c = *contents;
+    while (*c) {
+        const char* words[2] = { NULL, NULL };
+        size_t nwords = 0;
+        while (*c && *c != '\n') {
+            if (*c == ' ' || *c == '\t' || *c == '\r') {
+                *c++ = '\0';
+                continue;
+            }
+            if (nwords == 2) {
+                error_print("manifest '%s': expected '<input> <output>' on each line\n", filename);
+                exit(InvalidManifest);
+            }
+            words[nwords++] = c;
+            while (*c && *c != '\n' && *c != ' ' && *c != '\t' && *c != '\r')
+                c++;
+        }
+        if (*c == '\n')
+            *c++ = '\0';
+
+        if (nwords == 0)
+            continue;
+        if (nwords != 2) {
+            error_print("manifest '%s': expected '<input> <output>' on each line\n", filename);
+            exit(InvalidManifest);
+        }
+        append_list(const char*, filenames, words[0]);
+        append_list(const char*, filenames, words[1]);
+    }
+
+    // filenames is done growing, we can now safely point into it
+    size_t count = entries_count_list(filenames) / 2;
+    for (size_t i = 0; i < count; i++) {
+        SlimJob job = {
+            .num_input_files = 1,
+            .input_filenames = &read_list(const char*, filenames)[i * 2],
+            .output_filename = read_list(const char*, filenames)[i * 2 + 1],
+        };
+        append_list(SlimJob, jobs, job);
+    }
+}
+
+typedef struct {
+    const SlimConfig* args;
+    size_t num_jobs;
+    const SlimJob* jobs;
+    size_t volatile next_job;
+    /// status of each job, read once the pool is drained
+    int* results;
+} BatchQueue;
+
+static void batch_worker(void* user_data) {
+    BatchQueue* queue = (BatchQueue*) user_data;
+    while (true) {
+        size_t i = atomic_fetch_increment(&queue->next_job);
+        if (i >= queue->num_jobs)
+            break;
+        queue->results[i] = compile_job(queue->args, &queue->jobs[i]);
+    }
+}
+
+/// Returns how many jobs failed, after reporting them
+static size_t run_batch(const SlimConfig* args, size_t num_jobs, const SlimJob* jobs) {
+    BatchQueue queue = {
+        .args = args,
+        .num_jobs = num_jobs,
+        .jobs = jobs,
+        .next_job = 0,
+        .results = calloc(num_jobs, sizeof(int)),
+    };
+
+    size_t num_threads = args->jobs ? args->jobs : get_hardware_concurrency();
+    if (num_threads > num_jobs)
+        num_threads = num_jobs;
+    info_print("Compiling %zu programs on %zu threads\n", num_jobs, num_threads);
+
+    LARRAY(Thread*, threads, num_threads);
+    for (size_t i = 0; i < num_threads; i++)
+        threads[i] = spawn_thread(batch_worker, &queue);
+    for (size_t i = 0; i < num_threads; i++)
+        join_thread(threads[i]);
+
+    size_t failed = 0;
+    for (size_t i = 0; i < num_jobs; i++) {
+        if (queue.results[i] == NoError)
+            continue;
+        error_print("failed to compile %s (errcode=%d)\n", jobs[i].input_filenames[0], queue.results[i]);
+        failed++;
+    }
+    if (failed)
+        error_print("%zu out of %zu programs failed to compile\n", failed, num_jobs);
+    free(queue.results);
+    return failed;
+}
+
+int main(int argc, char** argv) {
+    platform_specific_terminal_init_extras();
 
     SlimConfig args = {
         .config = default_compiler_config(),
@@ -112,78 +437,63 @@ int main(int argc, char** argv) {
     parse_compiler_config_args(&args.config, &argc, argv);
     parse_input_files(args.input_filenames, &argc, argv);
 
-    if (entries_count_list(args.input_filenames) == 0) {
-        error_print("Missing input file. See --help for proper usage");
-        exit(MissingInputArg);
+    if (!args.batch) {
+        if (entries_count_list(args.input_filenames) == 0) {
+            error_print("Missing input file. See --help for proper usage");
+            exit(MissingInputArg);
+        }
+
+        SlimJob job = {
+            .num_input_files = entries_count_list(args.input_filenames),
+            .input_filenames = read_list(const char*, args.input_filenames),
+            .output_filename = args.output_filename,
+            .shd_output_filename = args.shd_output_filename,
+            .cfg_output_filename = args.cfg_output_filename,
+            .stats_filename = args.stats_filename,
+        };
+        int status = compile_job(&args, &job);
+        destroy_list(args.input_filenames);
+        return status;
     }
 
-    Module* mod = new_module(arena, "my_module");
+    if (args.output_filename || args.shd_output_filename || args.cfg_output_filename || args.stats_filename) {
+        error_print("--output, --dump-ir, --dump-cfg and --stats name a single file and cannot be used in batch mode, use --output-dir or a manifest instead\n");
+        exit(MissingOutputDirArg);
+    }
 
-    size_t num_source_files = entries_count_list(args.input_filenames);
-    CompilationResult parse_result = parse_files(&args.config, num_source_files, read_list(const char*, args.input_filenames), NULL, mod);
-    assert(parse_result == CompilationNoError);
-    destroy_list(args.input_filenames);
+    struct List* jobs = new_list(SlimJob);
+    struct List* manifest_filenames = new_list(const char*);
+    struct List* owned_filenames = new_list(char*);
+    char* manifest_contents = NULL;
 
-    info_print("Parsed program successfully: \n");
-    log_module(INFO, &args.config, mod);
+    if (args.manifest_filename)
+        parse_manifest(args.manifest_filename, jobs, manifest_filenames, &manifest_contents);
 
-    CompilationResult result = run_compiler_passes(&args.config, &mod);
-    if (result != CompilationNoError) {
-        error_print("Compilation pipeline failed, errcode=%d\n", (int) result);
-        exit(result);
+    size_t num_inputs = entries_count_list(args.input_filenames);
+    for (size_t i = 0; i < num_inputs; i++) {
+        char* output_filename = batch_output_filename(&args, read_list(const char*, args.input_filenames)[i]);
+        append_list(char*, owned_filenames, output_filename);
+        SlimJob job = {
+            .num_input_files = 1,
+            .input_filenames = &read_list(const char*, args.input_filenames)[i],
+            .output_filename = output_filename,
+        };
+        append_list(SlimJob, jobs, job);
     }
-    info_print("Ran all passes successfully\n");
 
-    if (args.cfg_output_filename) {
-        FILE* f = fopen(args.cfg_output_filename, "wb");
-        assert(f);
-        dump_cfg(f, mod);
-        fclose(f);
-        info_print("CFG dumped\n");
-    }
-
-    if (args.shd_output_filename) {
-        FILE* f = fopen(args.shd_output_filename, "wb");
-        assert(f);
-        size_t output_size;
-        char* output_buffer;
-        print_module_into_str(mod, &output_buffer, &output_size);
-        fwrite(output_buffer, output_size, 1, f);
-        free((void*) output_buffer);
-        fclose(f);
-        info_print("IR dumped\n");
-    }
-
-    if (args.output_filename) {
-        args.c_emitter_config.config = &args.config;
-        if (args.target == TgtAuto)
-            args.target = guess_target(args.output_filename);
-        FILE* f = fopen(args.output_filename, "wb");
-        size_t output_size;
-        char* output_buffer;
-        switch (args.target) {
-            case TgtAuto: SHADY_UNREACHABLE;
-            case TgtSPV: emit_spirv(&args.config, mod, &output_size, &output_buffer, NULL); break;
-            case TgtC:
-                args.c_emitter_config.dialect = C;
-                emit_c(args.c_emitter_config, mod, &output_size, &output_buffer, NULL);
-                break;
-            case TgtGLSL:
-                args.c_emitter_config.dialect = GLSL;
-                emit_c(args.c_emitter_config, mod, &output_size, &output_buffer, NULL);
-                break;
-            case TgtISPC:
-                args.c_emitter_config.dialect = ISPC;
-                emit_c(args.c_emitter_config, mod, &output_size, &output_buffer, NULL);
-                break;
-        }
-        fwrite(output_buffer, output_size, 1, f);
-        free((void*) output_buffer);
-        fclose(f);
+    size_t num_jobs = entries_count_list(jobs);
+    if (num_jobs == 0) {
+        error_print("Missing input file. See --help for proper usage");
+        exit(MissingInputArg);
     }
-    info_print("Done\n");
+    size_t failed = run_batch(&args, num_jobs, read_list(SlimJob, jobs));
 
-    destroy_ir_arena(arena);
-    destroy_ir_arena(get_module_arena(mod));
-    return NoError;
+    for (size_t i = 0; i < entries_count_list(owned_filenames); i++)
+        free(read_list(char*, owned_filenames)[i]);
+    destroy_list(owned_filenames);
+    destroy_list(manifest_filenames);
+    free(manifest_contents);
+    destroy_list(jobs);
+    destroy_list(args.input_filenames);
+    return failed ? BatchJobsFailed : NoError;
 }
@@ -715,7 +715,7 @@ size_t parse_spv_instruction_at(SpvParser* parser, size_t instruction_offset) {
             struct CurrBlock old = parser->current_block;
             parser->current_block.id = result;
 
-            Nodes params = empty(parser->arena);
+            NodesBuilder* params = begin_nodes(parser->arena);
             parser->fun_arg_i = 0;
             while (true) {
                 SpvOp param_op = (parser->words + instruction_offset)[0] & 0xFFFF;
@@ -735,7 +735,7 @@ size_t parse_spv_instruction_at(SpvParser* parser, size_t instruction_offset) {
                 if (is_param) {
                     const Node* param = get_definition_by_id(parser, get_result_defined_at(parser, instruction_offset))->node;
                     assert(param && param->tag == Variable_TAG);
-                    params = concat_nodes(parser->arena, params, singleton(param));
+                    append_to_nodes(params, param);
                 }
                 size += s;
                 instruction_offset += s;
@@ -746,7 +746,7 @@ size_t parse_spv_instruction_at(SpvParser* parser, size_t instruction_offset) {
             parser->defs[result].type = BB;
             String bb_name = get_name(parser, result);
             bb_name = bb_name ? bb_name : unique_name(parser->arena, "basic_block");
-            Node* block = basic_block(parser->arena, parser->fun, params, bb_name);
+            Node* block = basic_block(parser->arena, parser->fun, finish_nodes(params), bb_name);
             parser->defs[result].node = block;
 
             BodyBuilder* bb = begin_body(parser->mod);
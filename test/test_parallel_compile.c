@@ -0,0 +1,86 @@
+#include "shady/ir.h"
+
+#include "log.h"
+#include "portability.h"
+
+#include <stdlib.h>
+#include <assert.h>
+
+// Compiles every input file on several threads at once, each thread using its own arenas.
+// Any shared mutable state in the compiler shows up as a crash here, or under TSan.
+
+typedef struct {
+    size_t thread_id;
+    size_t num_files;
+    const char** files;
+    size_t failures;
+} ThreadCtx;
+
+static void compile_all(void* user_data) {
+    ThreadCtx* ctx = (ThreadCtx*) user_data;
+    // rotate the starting point so different threads are compiling different programs at a given time
+    for (size_t j = 0; j < ctx->num_files; j++) {
+        const char* file = ctx->files[(ctx->thread_id + j) % ctx->num_files];
+
+        CompilerConfig config = default_compiler_config();
+        config.allow_frontend_syntax = true;
+
+        IrArena* arena = new_ir_arena(default_arena_config());
+        Module* mod = new_module(arena, "my_module");
+        if (parse_files(&config, 1, &file, NULL, mod) != CompilationNoError || run_compiler_passes(&config, &mod) != CompilationNoError) {
+            ctx->failures++;
+        } else {
+            size_t output_size;
+            char* output_buffer;
+            emit_spirv(&config, mod, &output_size, &output_buffer, NULL);
+            if (output_size == 0)
+                ctx->failures++;
+            free(output_buffer);
+        }
+
+        // when parsing fails the module never left the arena it was made in
+        if (get_module_arena(mod) != arena)
+            destroy_ir_arena(get_module_arena(mod));
+        destroy_ir_arena(arena);
+    }
+}
+
+int main(int argc, char** argv) {
+    platform_specific_terminal_init_extras();
+    set_log_level(ERROR);
+
+    size_t num_files = argc - 1;
+    if (num_files == 0) {
+        error_print("Usage: test_parallel_compile file1.slim file2.slim ...\n");
+        return 1;
+    }
+
+    size_t num_threads = get_hardware_concurrency();
+    if (num_threads < 4)
+        num_threads = 4;
+
+    LARRAY(ThreadCtx, ctxs, num_threads);
+    LARRAY(Thread*, threads, num_threads);
+    for (size_t i = 0; i < num_threads; i++) {
+        ctxs[i] = (ThreadCtx) {
+            .thread_id = i,
+            .num_files = num_files,
+            .files = (const char**) &argv[1],
+            .failures = 0,
+        };
+        threads[i] = spawn_thread(compile_all, &ctxs[i]);
+    }
+
+    size_t failures = 0;
+    for (size_t i = 0; i < num_threads; i++) {
+        join_thread(threads[i]);
+        failures += ctxs[i].failures;
+    }
+
+    if (failures > 0) {
+        error_print("%zu compilations failed\n", failures);
+        return 1;
+    }
+    info_print("Compiled %zu files on %zu threads\n", num_files, num_threads);
+    return 0;
+}
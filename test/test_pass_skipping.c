@@ -0,0 +1,61 @@
+#include "shady/ir.h"
+
+#include "log.h"
+#include "portability.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Compiles every input file with and without skipping the lowering passes that have nothing to lower.
+// Skipping a pass is only valid when running it would have been an identity rewrite, so both must print the same module.
+
+static char* compile(const char* file, bool disable_pass_skipping) {
+    CompilerConfig config = default_compiler_config();
+    config.allow_frontend_syntax = true;
+    config.disable_pass_skipping = disable_pass_skipping;
+
+    IrArena* arena = new_ir_arena(default_arena_config());
+    Module* mod = new_module(arena, "my_module");
+    char* output = NULL;
+    if (parse_files(&config, 1, &file, NULL, mod) == CompilationNoError && run_compiler_passes(&config, &mod) == CompilationNoError) {
+        size_t output_size;
+        print_module_into_str(mod, &output, &output_size);
+    }
+
+    if (get_module_arena(mod) != arena)
+        destroy_ir_arena(get_module_arena(mod));
+    destroy_ir_arena(arena);
+    return output;
+}
+
+int main(int argc, char** argv) {
+    platform_specific_terminal_init_extras();
+    set_log_level(ERROR);
+
+    if (argc < 2) {
+        error_print("Usage: test_pass_skipping file1.slim file2.slim ...\n");
+        return 1;
+    }
+
+    size_t failures = 0;
+    for (int i = 1; i < argc; i++) {
+        char* skipped = compile(argv[i], false);
+        char* not_skipped = compile(argv[i], true);
+        if (!skipped || !not_skipped) {
+            error_print("failed to compile %s\n", argv[i]);
+            failures++;
+        } else if (strcmp(skipped, not_skipped) != 0) {
+            error_print("skipping passes changed the output for %s\n", argv[i]);
+            failures++;
+        }
+        free(skipped);
+        free(not_skipped);
+    }
+
+    if (failures > 0) {
+        error_print("%zu out of %d files failed\n", failures, argc - 1);
+        return 1;
+    }
+    info_print("Skipping passes did not change the output of %d files\n", argc - 1);
+    return 0;
+}